@@ -0,0 +1,89 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Microbenchmark for classifying lines received from the modem as
+ * final result codes (udiald_tty_classify), compared to the strncmp
+ * loop over a table of result strings that was used before.
+ */
+
+#include <string.h>
+#include "udiald.h"
+#include "bench.h"
+
+// Typical lines seen in responses, most of them not a result code
+static const char *lines[] = {
+	"OK",
+	"huawei",
+	"E220",
+	"+CPIN: READY",
+	"+GCAP: +CGSM,+DS,+ES",
+	"+COPS: 0,0,\"T-Mobile NL\",2",
+	"+CSQ: 14,99",
+	"^RSSI:14",
+	"ERROR",
+	"+CME ERROR: 10",
+	"CONNECT 7200000",
+	"NO CARRIER",
+};
+
+// The table as used by udiald_tty_get before it was generated
+static const char *oldresstr[] = {
+	[UDIALD_AT_OK] = "OK",
+	[UDIALD_AT_CONNECT] = "CONNECT",
+	[UDIALD_AT_ERROR] = "ERROR",
+	[UDIALD_AT_CMEERROR] = "+CME ERROR",
+	[UDIALD_AT_NODIALTONE] = "NO DIALTONE",
+	[UDIALD_AT_BUSY] = "BUSY",
+	[UDIALD_AT_NOCARRIER] = "NO CARRIER",
+	[UDIALD_AT_NOT_SUPPORTED] = "COMMAND NOT SUPPORT",
+};
+
+static enum udiald_atres old_classify(const char *line, size_t len, int *error) {
+	for (size_t i = 0; i < lengthof(oldresstr); ++i)
+		if (!strncmp(line, oldresstr[i], strlen(oldresstr[i])))
+			return i;
+	return UDIALD_FAIL;
+}
+
+struct classifier {
+	enum udiald_atres (*classify)(const char *line, size_t len, int *error);
+};
+
+static void bench_classify(void *priv) {
+	const struct classifier *c = priv;
+	static size_t lens[lengthof(lines)];
+	if (!lens[0])
+		for (size_t i = 0; i < lengthof(lines); ++i)
+			lens[i] = strlen(lines[i]);
+
+	// Prevent the compiler from optimizing away the calls
+	volatile int sink = 0;
+	int error;
+	for (size_t i = 0; i < lengthof(lines); ++i)
+		sink += c->classify(lines[i], lens[i], &error);
+	(void)sink;
+}
+
+int main(void) {
+	struct classifier generated = {udiald_tty_classify}, old = {old_classify};
+	bench_run("udiald_tty_classify", lengthof(lines), bench_classify, &generated);
+	bench_run("strncmp table (old)", lengthof(lines), bench_classify, &old);
+	return 0;
+}
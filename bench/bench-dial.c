@@ -0,0 +1,179 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Dial scenarios in virtual time.
+ *
+ * Runs the dial loop (udiald_tty_dial) against a simple simulated
+ * modem on the other end of a pair of pipes, using a virtual clock (see
+ * src/clock.c). The modem registers to the packet service after a
+ * delay that differs per scenario, and answers NO CARRIER when dialed
+ * before that. Each scenario is run both dialing blindly (retrying
+ * after NO CARRIER) and waiting for registration (polling +CGREG?)
+ * first. Scenarios take up to the full dial timeout in virtual time,
+ * but only microseconds in real time. Besides the real time per
+ * scenario, the outcomes, dial attempts and the virtual time until
+ * connecting are printed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <syslog.h>
+#include "udiald.h"
+#include "bench.h"
+
+// The same as in dial.c
+#define DIAL_TIMEOUT 90000
+#define DIAL_RETRY_DELAY 5000
+#define DIAL_REG_POLL 250
+#define DIAL_RETRIES 1
+// Time for the modem to answer NO CARRIER or CONNECT (in us)
+#define NOCARRIER_DELAY 3000000
+#define CONNECT_DELAY 1000000
+// Time for the modem to answer a query (in us)
+#define QUERY_DELAY 20000
+// Scenarios range from being registered right away to registering
+// after this many steps of REGISTER_STEP us (which is more than fits
+// in the dial timeout)
+#define MAX_REGISTER 14
+#define REGISTER_STEP 7000000
+
+struct modem {
+	int to_modem[2], from_modem[2];
+	char cmd[64];
+	size_t cmdlen;
+	int64_t registered_at;	/* Virtual time of registration */
+	const char *reply;	/* Pending reply */
+	int64_t reply_at;
+};
+
+struct scenarios {
+	struct modem m;
+	struct udiald_vclock vc;
+	int reg_poll;
+	unsigned next;
+	unsigned connected, failed, attempts;
+	int64_t virtual_us;
+};
+
+static int64_t modem_run(struct udiald_vclock *vc) {
+	struct modem *m = vc->priv;
+	bool registered = vc->now_us >= m->registered_at;
+	char c;
+
+	while (read(m->to_modem[0], &c, 1) == 1) {
+		if (c != '\r') {
+			if (m->cmdlen < sizeof(m->cmd) - 1)
+				m->cmd[m->cmdlen++] = c;
+			continue;
+		}
+		m->cmd[m->cmdlen] = '\0';
+		m->cmdlen = 0;
+		if (!strcmp(m->cmd, "AT+CGREG?")) {
+			m->reply = registered ? "\r\n+CGREG: 0,1\r\n\r\nOK\r\n" : "\r\n+CGREG: 0,2\r\n\r\nOK\r\n";
+			m->reply_at = vc->now_us + QUERY_DELAY;
+		} else if (!strncmp(m->cmd, "ATD", 3)) {
+			m->reply = registered ? "\r\nCONNECT\r\n" : "\r\nNO CARRIER\r\n";
+			m->reply_at = vc->now_us + (registered ? CONNECT_DELAY : NOCARRIER_DELAY);
+		} else {
+			// E.g. +CEREG? on a modem without LTE
+			m->reply = "\r\nERROR\r\n";
+			m->reply_at = vc->now_us + QUERY_DELAY;
+		}
+	}
+
+	if (!m->reply)
+		return INT64_MAX;
+	if (m->reply_at > vc->now_us)
+		return m->reply_at;
+	if (write(m->from_modem[1], m->reply, strlen(m->reply)) < 0) {
+		perror("write");
+		exit(1);
+	}
+	m->reply = NULL;
+	return INT64_MAX;
+}
+
+static void bench_scenario(void *priv) {
+	struct scenarios *s = priv;
+	struct udiald_tty_read r;
+
+	// The dial loop logs at notice level on every retry
+	udiald_log_setmask(LOG_UPTO(LOG_WARNING));
+
+	int64_t start = s->vc.now_us;
+	s->m.registered_at = start + (int64_t)(s->next++ % (MAX_REGISTER + 1)) * REGISTER_STEP;
+	struct udiald_tty_dial dial = {
+		.name = "sim",
+		.dialcmd = "ATD*99#\r",
+		.deadline = udiald_util_now_ms() + DIAL_TIMEOUT,
+		.retry_delay = DIAL_RETRY_DELAY,
+		.reg_poll = s->reg_poll,
+		.retries = DIAL_RETRIES,
+	};
+	if (udiald_tty_dial(s->m.from_modem[0], s->m.to_modem[1], &dial, &r) == UDIALD_AT_CONNECT) {
+		s->connected++;
+		s->virtual_us += s->vc.now_us - s->m.registered_at;
+	} else {
+		s->failed++;
+	}
+	s->attempts += dial.attempts;
+
+	// Forget about replies still underway after a timeout
+	s->m.reply = NULL;
+	udiald_tty_drain(s->m.from_modem[0]);
+}
+
+static void modem_open(struct modem *m) {
+	if (pipe(m->to_modem) < 0 || pipe(m->from_modem) < 0) {
+		perror("pipe");
+		exit(1);
+	}
+	for (int i = 0; i < 2; ++i) {
+		fcntl(m->to_modem[i], F_SETFL, O_NONBLOCK);
+		fcntl(m->from_modem[i], F_SETFL, O_NONBLOCK);
+	}
+}
+
+static void run(const char *name, struct scenarios *s, int reg_poll) {
+	s->reg_poll = reg_poll;
+	s->next = s->connected = s->failed = s->attempts = 0;
+	s->virtual_us = 0;
+	bench_run(name, 1, bench_scenario, s);
+
+	unsigned total = s->connected + s->failed;
+	printf("%u scenarios: %u connected, %u timed out, %.1f dial attempts per scenario, connected %.1f s after registration\n",
+		total, s->connected, s->failed, (double)s->attempts / total,
+		s->connected ? s->virtual_us / 1e6 / s->connected : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+	static struct scenarios s;
+
+	modem_open(&s.m);
+	udiald_vclock_init(&s.vc, modem_run, &s.m);
+	udiald_clock_set(&s.vc.clock);
+
+	run("dial blindly (virtual time)", &s, 0);
+	run("dial once registered (virtual time)", &s, DIAL_REG_POLL);
+	return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Benchmark for USB device discovery (udiald_modem_find_devices), on a
+ * fake sysfs tree created by tools/sysfs-fixture.sh.
+ *
+ * Usage: bench/bench-discovery [root]
+ *
+ * Without a root, a tree with 16 hubs of 16 ports each (256 devices,
+ * the last of which is a modem) is created in a temporary directory.
+ * Besides the time per discovery, the number of file system calls done
+ * by udiald itself is printed. These are counted by wrapping them at
+ * link time, so the directory reads done inside glob() are not seen
+ * separately, only the number of glob() calls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glob.h>
+#include "udiald.h"
+#include "bench.h"
+
+// Tree to create when no root is given
+#define FIXTURE_OPTIONS "-d 1 -f 16 -m 1"
+// Device id of the modem in that tree
+#define FIXTURE_MODEM "1-16.16"
+
+static unsigned long calls_open, calls_read, calls_close, calls_readlink, calls_glob;
+
+int __real_open(const char *path, int flags, int mode);
+ssize_t __real_read(int fd, void *buf, size_t count);
+int __real_close(int fd);
+ssize_t __real_readlink(const char *path, char *buf, size_t size);
+int __real_glob(const char *pattern, int flags, int (*errfunc)(const char *, int), glob_t *pglob);
+
+int __wrap_open(const char *path, int flags, int mode) {
+	calls_open++;
+	return __real_open(path, flags, mode);
+}
+
+ssize_t __wrap_read(int fd, void *buf, size_t count) {
+	calls_read++;
+	return __real_read(fd, buf, count);
+}
+
+int __wrap_close(int fd) {
+	calls_close++;
+	return __real_close(fd);
+}
+
+ssize_t __wrap_readlink(const char *path, char *buf, size_t size) {
+	calls_readlink++;
+	return __real_readlink(path, buf, size);
+}
+
+int __wrap_glob(const char *pattern, int flags, int (*errfunc)(const char *, int), glob_t *pglob) {
+	calls_glob++;
+	return __real_glob(pattern, flags, errfunc, pglob);
+}
+
+struct discovery {
+	struct udiald_state state;
+	struct udiald_device_filter filter;
+	struct udiald_modem modem;
+	size_t found;
+};
+
+static void count_device(struct udiald_modem *modem, void *data) {
+	struct discovery *d = data;
+	d->found++;
+}
+
+// Like --list-devices
+static void bench_list(void *priv) {
+	struct discovery *d = priv;
+	udiald_modem_find_devices(&d->state, &d->modem, count_device, d, &d->filter);
+}
+
+// Like selecting the modem to connect with
+static void bench_first(void *priv) {
+	struct discovery *d = priv;
+	udiald_modem_find_devices(&d->state, &d->modem, NULL, NULL, &d->filter);
+}
+
+static void run(const char *name, struct discovery *d, bench_fn fn) {
+	bench_run(name, 1, fn, d);
+
+	calls_open = calls_read = calls_close = calls_readlink = calls_glob = 0;
+	d->found = 0;
+	fn(d);
+	printf("%-40s %lu open, %lu read, %lu close, %lu readlink, %lu glob\n", "",
+		calls_open, calls_read, calls_close, calls_readlink, calls_glob);
+}
+
+int main(int argc, char *argv[]) {
+	static struct discovery d;
+	char tmp[] = "/tmp/udiald-fixture-XXXXXX";
+	char cmd[256];
+	const char *modem_id = NULL;
+
+	if (argc > 1) {
+		d.state.root = argv[1];
+	} else {
+		if (!mkdtemp(tmp)) {
+			perror("mkdtemp");
+			return 1;
+		}
+		snprintf(cmd, sizeof(cmd), "tools/sysfs-fixture.sh " FIXTURE_OPTIONS " %s", tmp);
+		if (system(cmd)) {
+			fprintf(stderr, "Failed to create fixture in %s\n", tmp);
+			return 1;
+		}
+		d.state.root = tmp;
+		modem_id = FIXTURE_MODEM;
+	}
+	INIT_LIST_HEAD(&d.state.custom_profiles);
+
+	run("list devices", &d, bench_list);
+	printf("%-40s %zu devices\n", "", d.found);
+
+	d.filter.flags = UDIALD_FILTER_PROFILE;
+	run("select first usable device", &d, bench_first);
+
+	if (modem_id) {
+		d.filter.device_id = (char *)modem_id;
+		run("select device by id", &d, bench_first);
+
+		snprintf(cmd, sizeof(cmd), "rm -rf %s", tmp);
+		if (system(cmd))
+			fprintf(stderr, "Failed to remove %s\n", tmp);
+	}
+	return 0;
+}
@@ -0,0 +1,47 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Microbenchmark for looking up modes by name (udiald_modem_modeval).
+ */
+
+#include "udiald.h"
+#include "bench.h"
+
+// All valid mode names, plus an invalid one
+static const char *modes[] = {
+	"auto",
+	"force_umts",
+	"force_gprs",
+	"prefer_umts",
+	"prefer_gprs",
+	"invalid",
+};
+
+static void bench_modeval(void *priv) {
+	volatile int sink = 0;
+	for (size_t i = 0; i < lengthof(modes); ++i)
+		sink += udiald_modem_modeval(modes[i]);
+	(void)sink;
+}
+
+int main(void) {
+	bench_run("udiald_modem_modeval", lengthof(modes), bench_modeval, NULL);
+	return 0;
+}
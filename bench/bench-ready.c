@@ -0,0 +1,181 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Waiting for the modem to be ready after entering the PIN, in virtual
+ * time.
+ *
+ * Runs udiald_tty_wait_ready against a simple simulated modem on the
+ * other end of a socket pair, using a virtual clock (see src/clock.c).
+ * Depending on the scenario, the SIM reports busy (+CME ERROR: 14) for
+ * a while, the modem registers after a delay (or never), or it does
+ * not answer at all. Besides the real time per scenario, the virtual
+ * time until udiald goes on is printed, which should never be more
+ * than the timeout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <syslog.h>
+#include <sys/socket.h>
+#include "udiald.h"
+#include "bench.h"
+
+// The same as in udiald.c
+#define READY_TIMEOUT 5000
+#define READY_POLL 250
+// Time for the modem to answer a query (in us)
+#define QUERY_DELAY 20000
+
+struct scenario {
+	const char *name;
+	int sim_busy;		/* SIM reports busy for this long (in ms) */
+	int registered;		/* Registered after this long (in ms), -1 for never */
+	bool silent;		/* The modem does not answer at all */
+};
+
+static const struct scenario scenarios[] = {
+	{ "ready right away", 0, 0, false },
+	{ "SIM busy for 300 ms", 300, 0, false },
+	{ "registered after 800 ms", 0, 800, false },
+	{ "SIM busy for 1 s, registered after 3 s", 1000, 3000, false },
+	{ "never registered", 0, -1, false },
+	{ "no answer", 0, 0, true },
+};
+
+struct modem {
+	int fds[2];		/* udiald side, modem side */
+	char cmd[64];
+	size_t cmdlen;
+	const struct scenario *s;
+	int64_t start;		/* Virtual time the scenario started */
+	char reply[128];	/* Pending reply */
+	int64_t reply_at;
+};
+
+struct bench {
+	struct modem m;
+	struct udiald_vclock vc;
+	const struct scenario *s;
+	struct udiald_tty_ready ready;
+};
+
+// Answer a command line like AT+CPIN?;+CREG?
+static void modem_answer(struct modem *m, int64_t now) {
+	int64_t ms = (now - m->start) / 1000;
+	bool sim_busy = ms < m->s->sim_busy;
+	bool registered = m->s->registered >= 0 && ms >= m->s->registered;
+
+	m->reply[0] = '\0';
+	char *save, *c = m->cmd + 2;
+	for (c = strtok_r(c, ";", &save); c; c = strtok_r(NULL, ";", &save)) {
+		if (!strcmp(c, "+CPIN?")) {
+			if (sim_busy) {
+				strcpy(m->reply, "\r\n+CME ERROR: 14\r\n");
+				return;
+			}
+			strcat(m->reply, "\r\n+CPIN: READY\r\n");
+		} else if (!strcmp(c, "+CREG?")) {
+			strcat(m->reply, registered ? "\r\n+CREG: 0,1\r\n" : "\r\n+CREG: 0,2\r\n");
+		}
+	}
+	strcat(m->reply, "\r\nOK\r\n");
+}
+
+static int64_t modem_run(struct udiald_vclock *vc) {
+	struct modem *m = vc->priv;
+	char c;
+
+	while (read(m->fds[1], &c, 1) == 1) {
+		if (c != '\r') {
+			if (m->cmdlen < sizeof(m->cmd) - 1)
+				m->cmd[m->cmdlen++] = c;
+			continue;
+		}
+		m->cmd[m->cmdlen] = '\0';
+		m->cmdlen = 0;
+		if (m->s->silent)
+			continue;
+		modem_answer(m, vc->now_us);
+		m->reply_at = vc->now_us + QUERY_DELAY;
+	}
+
+	if (!m->reply[0])
+		return INT64_MAX;
+	if (m->reply_at > vc->now_us)
+		return m->reply_at;
+	if (write(m->fds[1], m->reply, strlen(m->reply)) < 0) {
+		perror("write");
+		exit(1);
+	}
+	m->reply[0] = '\0';
+	return INT64_MAX;
+}
+
+static void bench_scenario(void *priv) {
+	struct bench *b = priv;
+
+	// Giving up is logged at notice level
+	udiald_log_setmask(LOG_UPTO(LOG_WARNING));
+
+	b->m.s = b->s;
+	b->m.start = b->vc.now_us;
+	b->ready = (struct udiald_tty_ready) {
+		.name = "sim",
+		.timeout = READY_TIMEOUT,
+		.poll = READY_POLL,
+		.registration = true,
+	};
+	udiald_tty_wait_ready(b->m.fds[0], &b->ready);
+
+	// Forget about replies still underway after a timeout
+	b->m.reply[0] = '\0';
+	udiald_tty_drain(b->m.fds[0]);
+}
+
+int main(int argc, char *argv[]) {
+	static struct bench b;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, b.m.fds) < 0) {
+		perror("socketpair");
+		return 1;
+	}
+	for (int i = 0; i < 2; ++i)
+		fcntl(b.m.fds[i], F_SETFL, O_NONBLOCK);
+	udiald_vclock_init(&b.vc, modem_run, &b.m);
+	udiald_clock_set(&b.vc.clock);
+
+	for (size_t i = 0; i < lengthof(scenarios); ++i) {
+		char name[128];
+		b.s = &scenarios[i];
+		snprintf(name, sizeof(name), "wait ready, %s (virtual time)", b.s->name);
+		bench_run(name, 1, bench_scenario, &b);
+		printf("going on after %d ms: SIM %s, %s\n", b.ready.elapsed,
+			b.ready.sim ? "ready" : "not ready",
+			b.ready.registered ? "registered" : "not registered");
+		if (b.ready.elapsed > READY_TIMEOUT) {
+			fprintf(stderr, "Waited longer than the timeout of %d ms\n", READY_TIMEOUT);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,59 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Cost of recording events in the trace ring (see src/trace.c), which
+ * happens for every read and write on the tty, whether or not the
+ * trace is ever dumped.
+ */
+
+#include <string.h>
+#include "udiald.h"
+#include "bench.h"
+
+static const char short_line[] = "\r\nOK\r\n";
+static const char long_line[] = "\r\n+COPS: 0,0,\"Vodafone.de\",2\r\n\r\n+CSQ: 18,99\r\n\r\nOK\r\n";
+
+static void bench_short(void *priv) {
+	udiald_trace(UDIALD_TRACE_RX, 3, 0, short_line, strlen(short_line));
+}
+
+static void bench_long(void *priv) {
+	udiald_trace(UDIALD_TRACE_RX, 3, 0, long_line, strlen(long_line));
+}
+
+static void bench_command(void *priv) {
+	struct iovec iov[] = {
+		{.iov_base = "AT+CPIN=\"1234\"", .iov_len = 14},
+		{.iov_base = "\r", .iov_len = 1},
+	};
+	udiald_tracev(UDIALD_TRACE_TX, 3, 0, iov, 2);
+}
+
+static void bench_event(void *priv) {
+	udiald_trace(UDIALD_TRACE_POLL, 3, 1, NULL, 0);
+}
+
+int main(int argc, char *argv[]) {
+	bench_run("trace poll event", 1, bench_event, NULL);
+	bench_run("trace short response (6 bytes)", 1, bench_short, NULL);
+	bench_run("trace long response (56 bytes)", 1, bench_long, NULL);
+	bench_run("trace PIN command (redacted)", 1, bench_command, NULL);
+	return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Microbenchmarks for reading responses (udiald_tty_get, which splits
+ * the received data into lines and classifies them) and for
+ * udiald_tty_flatten_result.
+ *
+ * Responses are fed through a pipe, so the numbers include the read()
+ * calls. Besides a synthetic stream of typical responses, transcripts
+ * recorded with udiald --transcript can be given on the commandline.
+ * The data received in those is fed in the same chunks as it was
+ * originally read, using udiald_tty_fill and udiald_tty_parse (which
+ * is what udiald_tty_get does, without waiting for data).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "udiald.h"
+#include "bench.h"
+
+// Typical responses during startup and while connected
+static const char *responses[] = {
+	"\r\nOK\r\n",
+	"\r\nhuawei\r\n\r\nE220\r\n\r\nOK\r\n",
+	"\r\n+CPIN: READY\r\n\r\nOK\r\n",
+	"\r\n+GCAP: +CGSM,+DS,+ES\r\n\r\nOK\r\n",
+	"\r\n+COPS: 0,0,\"T-Mobile NL\",2\r\n\r\n+CSQ: 14,99\r\n\r\nOK\r\n",
+	"\r\n+CME ERROR: 10\r\n",
+	"\r\n^RSSI:14\r\n\r\n+CSQ: 14,99\r\n\r\nOK\r\n",
+	"\r\nNO CARRIER\r\n",
+	"\r\nCONNECT 7200000\r\n",
+};
+
+// A stream of received data chunks. A NULL chunk marks a command sent.
+struct stream {
+	int rd, wr;
+	size_t nchunks;
+	char **chunks;
+	size_t *lens;
+	size_t responses;
+	struct udiald_tty_read r;
+};
+
+static void stream_add(struct stream *s, const char *data, size_t len) {
+	s->chunks = realloc(s->chunks, (s->nchunks + 1) * sizeof(*s->chunks));
+	s->lens = realloc(s->lens, (s->nchunks + 1) * sizeof(*s->lens));
+	s->chunks[s->nchunks] = data ? malloc(len) : NULL;
+	if (data)
+		memcpy(s->chunks[s->nchunks], data, len);
+	s->lens[s->nchunks++] = len;
+}
+
+static void stream_open(struct stream *s) {
+	int p[2];
+	if (pipe(p) < 0) {
+		perror("pipe");
+		exit(1);
+	}
+	fcntl(p[0], F_SETFL, O_NONBLOCK);
+	s->rd = p[0];
+	s->wr = p[1];
+}
+
+static void stream_write(struct stream *s, size_t i) {
+	if (write(s->wr, s->chunks[i], s->lens[i]) != s->lens[i]) {
+		perror("write");
+		exit(1);
+	}
+}
+
+// Feed every response through the pipe and read it
+static void bench_get(void *priv) {
+	struct stream *s = priv;
+	for (size_t i = 0; i < s->nchunks; ++i) {
+		stream_write(s, i);
+		udiald_tty_get(s->rd, &s->r, NULL, 1000);
+	}
+}
+
+// Feed every recorded chunk through the pipe and parse it
+static void bench_parse(void *priv) {
+	struct stream *s = priv;
+	for (size_t i = 0; i < s->nchunks; ++i) {
+		if (!s->chunks[i]) {
+			udiald_tty_read_init(&s->r);
+			continue;
+		}
+		stream_write(s, i);
+		udiald_tty_fill(s->rd);
+		if (udiald_tty_parse(s->rd, &s->r, NULL) != UDIALD_FAIL)
+			udiald_tty_drain(s->rd);
+	}
+}
+
+// Load the data received on the control tty from a transcript.
+// Returns false when the transcript cannot be read.
+static bool stream_load(struct stream *s, const char *path) {
+	static struct udiald_transcript_record rec;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0 || udiald_transcript_read_header(fd) != UDIALD_OK) {
+		fprintf(stderr, "%s: Not a udiald transcript\n", path);
+		return false;
+	}
+
+	while (udiald_transcript_read(fd, &rec) > 0) {
+		if (rec.channel != UDIALD_TRANSCRIPT_CONTROL)
+			continue;
+		if (rec.dir == UDIALD_TRANSCRIPT_TX) {
+			stream_add(s, NULL, 0);
+			s->responses++;
+		} else {
+			stream_add(s, rec.data, rec.len);
+		}
+	}
+	close(fd);
+	return s->responses > 0;
+}
+
+static void bench_flatten(void *priv) {
+	struct udiald_tty_read *r = priv;
+	volatile const char *sink = udiald_tty_flatten_result(r);
+	(void)sink;
+}
+
+int main(int argc, char *const argv[]) {
+	struct stream synthetic = {0};
+	stream_open(&synthetic);
+	for (size_t i = 0; i < lengthof(responses); ++i)
+		stream_add(&synthetic, responses[i], strlen(responses[i]));
+	synthetic.responses = synthetic.nchunks;
+	bench_run("udiald_tty_get (synthetic)", synthetic.responses, bench_get, &synthetic);
+
+	for (int i = 1; i < argc; ++i) {
+		struct stream recorded = {0};
+		char name[128];
+		if (!stream_load(&recorded, argv[i]))
+			return 1;
+		stream_open(&recorded);
+		snprintf(name, sizeof(name), "udiald_tty_parse (%s)", argv[i]);
+		bench_run(name, recorded.responses, bench_parse, &recorded);
+	}
+
+	char *lines[] = {"+COPS: 0,0,\"T-Mobile NL\",2", "+CSQ: 14,99", "OK"};
+	struct udiald_tty_read r = {.lines = lengthof(lines), .raw_lines = lines};
+	bench_run("udiald_tty_flatten_result", 1, bench_flatten, &r);
+	return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Shared benchmark harness.
+ *
+ * Allocations are counted by wrapping malloc, calloc and realloc at
+ * link time (-Wl,--wrap=...), so only allocations done by udiald code
+ * are seen, not those done inside libc.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <time.h>
+#include "udiald.h"
+#include "bench.h"
+
+// Minimum time to run each benchmark for (in ns)
+#define BENCH_MIN_TIME 200e6
+
+int verbose = 0;
+
+static unsigned long allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+	allocs++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+	allocs++;
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	allocs++;
+	return __real_realloc(ptr, size);
+}
+
+unsigned long bench_allocs(void) {
+	return allocs;
+}
+
+double bench_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void bench_run(const char *name, size_t ops_per_call, bench_fn fn, void *priv) {
+	// Log like udiald does by default, debug messages are not free
+	udiald_log_setmask(LOG_UPTO(LOG_NOTICE));
+
+	// Warm up, so one-time allocations and cache misses are not
+	// counted
+	fn(priv);
+
+	size_t calls = 1;
+	while (true) {
+		unsigned long allocs_start = allocs;
+		double start = bench_now_ns();
+		for (size_t i = 0; i < calls; ++i)
+			fn(priv);
+		double elapsed = bench_now_ns() - start;
+
+		if (elapsed >= BENCH_MIN_TIME) {
+			double ops = (double)calls * ops_per_call;
+			printf("%-40s %10.1f ns/op %8.2f allocs/op\n", name,
+				elapsed / ops, (allocs - allocs_start) / ops);
+			return;
+		}
+		calls *= 2;
+	}
+}
@@ -0,0 +1,39 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+#ifndef UDIALD_BENCH_H_
+#define UDIALD_BENCH_H_
+
+#include <stddef.h>
+
+/* Run a benchmark. fn is called repeatedly (with an increasing
+ * repeat count) until it has run for long enough, and must do
+ * ops_per_call operations each time it is called. The time and number
+ * of heap allocations (malloc, calloc or realloc) per operation are
+ * printed. */
+typedef void (*bench_fn)(void *priv);
+void bench_run(const char *name, size_t ops_per_call, bench_fn fn, void *priv);
+
+/* Number of heap allocations so far */
+unsigned long bench_allocs(void);
+
+/* CLOCK_MONOTONIC, in ns */
+double bench_now_ns(void);
+
+#endif
@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+
+# This script generates the matcher used by udiald_tty_parse to find
+# out if a line received from the modem is a final result code.
+#
+# Run as:
+#   ./gen-atres.py > atres_table.h
+#
+# The generated function switches on the first character of the line
+# (and on further characters when result codes share a first
+# character), so every line is classified in a single pass using at
+# most one memcmp with a length known at compile time.
+#
+#   This program is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 2 of the License, or
+#   (at your option) any later version.
+
+import os
+
+# (text, result, exact)
+#
+# When exact is False, any line starting with text matches (e.g.
+# "CONNECT 7200000" or "+CME ERROR: 10"), otherwise the line must
+# consist of just text.
+RESULTS = [
+    # Verbose result codes (ATV1, the default)
+    ("OK", "UDIALD_AT_OK", False),
+    ("CONNECT", "UDIALD_AT_CONNECT", False),
+    ("ERROR", "UDIALD_AT_ERROR", False),
+    ("+CME ERROR", "UDIALD_AT_CMEERROR", False),
+    ("+CMS ERROR", "UDIALD_AT_CMSERROR", False),
+    ("NO DIALTONE", "UDIALD_AT_NODIALTONE", False),
+    ("BUSY", "UDIALD_AT_BUSY", False),
+    ("NO CARRIER", "UDIALD_AT_NOCARRIER", False),
+    ("NO ANSWER", "UDIALD_AT_NOANSWER", False),
+    # This one seems to be Huawei-specific:
+    ("COMMAND NOT SUPPORT", "UDIALD_AT_NOT_SUPPORTED", False),
+    # Numeric result codes (ATV0) are not matched: udiald never
+    # switches to them, and an information line consisting of a
+    # single digit (e.g. a +CGATT? answer without prefix) would end
+    # the response early.
+]
+
+def c_string(s):
+    return '"%s"' % s.replace('\\', '\\\\').replace('"', '\\"')
+
+def c_char(c):
+    return "'%s'" % c.replace('\\', '\\\\').replace("'", "\\'")
+
+def emit_match(entry, indent):
+    text, result, exact = entry
+    tabs = "\t" * indent
+    if exact:
+        cond = "len == %d" % len(text)
+    else:
+        cond = "len >= %d" % len(text)
+    print("%sif (%s && !memcmp(line, %s, %d))" % (tabs, cond, c_string(text), len(text)))
+    print("%s\treturn %s;" % (tabs, result))
+
+def emit(entries, pos, indent):
+    """
+    Emit code matching the given entries, which all have the same
+    characters before pos.
+    """
+    tabs = "\t" * indent
+    if len(entries) == 1:
+        emit_match(entries[0], indent)
+        return
+
+    # Entries that end at pos cannot be distinguished by looking
+    # further, so check those first.
+    for e in [e for e in entries if len(e[0]) == pos]:
+        emit_match(e, indent)
+    entries = [e for e in entries if len(e[0]) > pos]
+    if not entries:
+        return
+
+    chars = sorted(set(e[0][pos] for e in entries))
+    if len(chars) == 1:
+        emit(entries, pos + 1, indent)
+        return
+
+    print("%sif (len > %d) {" % (tabs, pos))
+    print("%s\tswitch (line[%d]) {" % (tabs, pos))
+    for c in chars:
+        print("%s\t\tcase %s:" % (tabs, c_char(c)))
+        emit([e for e in entries if e[0][pos] == c], pos + 1, indent + 3)
+        print("%s\t\t\tbreak;" % tabs)
+    print("%s\t}" % tabs)
+    print("%s}" % tabs)
+
+print(
+"""
+// This file is autogenerated by %s. Do not make
+// changes to it directly, change the table in that script instead.
+// Also, don't include this file, use udiald_tty_classify instead.
+
+/**
+ * Find out if the given line (of len bytes, excluding the nul
+ * terminator) is a final result code. Returns the result code, or
+ * UDIALD_FAIL for any other line.
+ */
+static inline enum udiald_atres udiald_atres_match(const char *line, size_t len) {""" % os.path.basename(__file__))
+emit(RESULTS, 0, 1)
+print("\treturn UDIALD_FAIL;")
+print("}")
@@ -0,0 +1,169 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Asynchronous AT command engine.
+ *
+ * Instead of blocking in udiald_tty_get until a response arrives,
+ * commands are queued together with a completion callback and run one
+ * after the other from the uloop event loop, so waiting for the modem
+ * can be combined with waiting for timers, signals or other fds.
+ */
+
+#include <syslog.h>
+#include <string.h>
+#include <errno.h>
+#include "udiald.h"
+
+static void udiald_at_start(struct udiald_at *at);
+
+/**
+ * Finish the current command, call its callback and start the next
+ * command in the queue (if any).
+ */
+static void udiald_at_complete(struct udiald_at *at, enum udiald_atres res) {
+	struct udiald_at_cmd *cmd = at->current;
+	int err = errno;
+
+	uloop_timeout_cancel(&at->timeout);
+	at->current = NULL;
+	udiald_cmdstats_done(res, err);
+
+	if (cmd->cb) {
+		errno = err;
+		cmd->cb(cmd, res, &at->r);
+	}
+
+	// The callback might have queued (and thus started) a new
+	// command already
+	if (!at->current)
+		udiald_at_start(at);
+}
+
+/**
+ * Send the first command from the queue, if no command is running
+ * already.
+ */
+static void udiald_at_start(struct udiald_at *at) {
+	if (at->current)
+		return;
+
+	// Anything received before the command was sent cannot be part
+	// of its response. Note that URC handlers called from here might
+	// queue (and thus start) a command themselves.
+	udiald_tty_drain(at->fd.fd);
+
+	if (at->current || list_empty(&at->queue))
+		return;
+
+	struct udiald_at_cmd *cmd = list_first_entry(&at->queue, struct udiald_at_cmd, h);
+	list_del(&cmd->h);
+
+	at->current = cmd;
+	udiald_tty_read_init(&at->r);
+
+	if (udiald_tty_put(at->fd.fd, cmd->command) < 0) {
+		udiald_log(LOG_ERR, "Failed to send command: %s", strerror(errno));
+		udiald_at_complete(at, UDIALD_FAIL);
+		return;
+	}
+	uloop_timeout_set(&at->timeout, udiald_cmdstats_timeout(cmd->timeout));
+}
+
+static void udiald_at_fd_cb(struct uloop_fd *u, unsigned int events) {
+	struct udiald_at *at = container_of(u, struct udiald_at, fd);
+
+	udiald_trace(UDIALD_TRACE_WAKEUP, u->fd, events, NULL, 0);
+	ssize_t rxed = udiald_tty_fill(u->fd);
+	if (rxed < 0 && errno != ERANGE) {
+		// Stop listening, to prevent being called over and
+		// over again for the same error.
+		uloop_fd_delete(u);
+		if (at->current)
+			udiald_at_complete(at, UDIALD_FAIL);
+		return;
+	}
+	// Nothing left to read from a tty that hung up (e.g. the modem
+	// was unplugged). It stays readable, so this must stop listening
+	// as well.
+	bool hangup = rxed == 0 && (u->error || u->eof || errno != EAGAIN);
+
+	if (!at->current) {
+		udiald_tty_drain(u->fd);
+	} else {
+		enum udiald_atres res = udiald_tty_parse(u->fd, &at->r, at->current->prefix);
+		if (res != UDIALD_FAIL || errno != EAGAIN) {
+			udiald_at_complete(at, res);
+			return;
+		}
+	}
+
+	if (hangup) {
+		udiald_log(LOG_ERR, "Terminal hung up");
+		if (u->registered)
+			uloop_fd_delete(u);
+		if (at->current) {
+			errno = EIO;
+			udiald_at_complete(at, UDIALD_FAIL);
+		}
+	}
+}
+
+static void udiald_at_timeout_cb(struct uloop_timeout *t) {
+	struct udiald_at *at = container_of(t, struct udiald_at, timeout);
+
+	udiald_log(LOG_ERR, "Timed out waiting for response");
+	errno = ETIMEDOUT;
+	udiald_at_complete(at, UDIALD_FAIL);
+}
+
+/**
+ * Set up an AT engine for the given (non-blocking) tty fd and register
+ * it with uloop. uloop_init must have been called already.
+ */
+void udiald_at_init(struct udiald_at *at, int fd) {
+	memset(at, 0, sizeof(*at));
+	INIT_LIST_HEAD(&at->queue);
+	at->fd.fd = fd;
+	at->fd.cb = udiald_at_fd_cb;
+	at->timeout.cb = udiald_at_timeout_cb;
+	uloop_fd_add(&at->fd, ULOOP_READ);
+}
+
+/**
+ * Queue a command. It is sent right away when no other command is
+ * running, or else after all previously queued commands have completed.
+ */
+void udiald_at_queue(struct udiald_at *at, struct udiald_at_cmd *cmd) {
+	list_add_tail(&cmd->h, &at->queue);
+	udiald_at_start(at);
+}
+
+/**
+ * Unregister the AT engine from uloop. Queued commands are dropped
+ * without calling their callbacks. Any response still underway is
+ * left in the receive buffer of the tty.
+ */
+void udiald_at_done(struct udiald_at *at) {
+	if (at->fd.registered)
+		uloop_fd_delete(&at->fd);
+	uloop_timeout_cancel(&at->timeout);
+	INIT_LIST_HEAD(&at->queue);
+	at->current = NULL;
+}
@@ -0,0 +1,75 @@
+
+// This file is autogenerated by gen-atres.py. Do not make
+// changes to it directly, change the table in that script instead.
+// Also, don't include this file, use udiald_tty_classify instead.
+
+/**
+ * Find out if the given line (of len bytes, excluding the nul
+ * terminator) is a final result code. Returns the result code, or
+ * UDIALD_FAIL for any other line.
+ */
+static inline enum udiald_atres udiald_atres_match(const char *line, size_t len) {
+	if (len > 0) {
+		switch (line[0]) {
+			case '+':
+				if (len > 3) {
+					switch (line[3]) {
+						case 'E':
+							if (len >= 10 && !memcmp(line, "+CME ERROR", 10))
+								return UDIALD_AT_CMEERROR;
+							break;
+						case 'S':
+							if (len >= 10 && !memcmp(line, "+CMS ERROR", 10))
+								return UDIALD_AT_CMSERROR;
+							break;
+					}
+				}
+				break;
+			case 'B':
+				if (len >= 4 && !memcmp(line, "BUSY", 4))
+					return UDIALD_AT_BUSY;
+				break;
+			case 'C':
+				if (len > 2) {
+					switch (line[2]) {
+						case 'M':
+							if (len >= 19 && !memcmp(line, "COMMAND NOT SUPPORT", 19))
+								return UDIALD_AT_NOT_SUPPORTED;
+							break;
+						case 'N':
+							if (len >= 7 && !memcmp(line, "CONNECT", 7))
+								return UDIALD_AT_CONNECT;
+							break;
+					}
+				}
+				break;
+			case 'E':
+				if (len >= 5 && !memcmp(line, "ERROR", 5))
+					return UDIALD_AT_ERROR;
+				break;
+			case 'N':
+				if (len > 3) {
+					switch (line[3]) {
+						case 'A':
+							if (len >= 9 && !memcmp(line, "NO ANSWER", 9))
+								return UDIALD_AT_NOANSWER;
+							break;
+						case 'C':
+							if (len >= 10 && !memcmp(line, "NO CARRIER", 10))
+								return UDIALD_AT_NOCARRIER;
+							break;
+						case 'D':
+							if (len >= 11 && !memcmp(line, "NO DIALTONE", 11))
+								return UDIALD_AT_NODIALTONE;
+							break;
+					}
+				}
+				break;
+			case 'O':
+				if (len >= 2 && !memcmp(line, "OK", 2))
+					return UDIALD_AT_OK;
+				break;
+		}
+	}
+	return UDIALD_FAIL;
+}
@@ -0,0 +1,135 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Source of time for everything that waits or times out.
+ *
+ * By default this is the real CLOCK_MONOTONIC clock, but a virtual
+ * clock can be installed instead (for simulations and benchmarks). A
+ * virtual clock only advances when udiald would otherwise wait. Its
+ * run callback is then called to let simulated peers (e.g. a simulated
+ * modem on the other end of a pipe) act, and time jumps straight to
+ * the next event, so waits do not take any real time.
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include "udiald.h"
+
+static int64_t udiald_clock_real_now_us(struct udiald_clock *c) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void udiald_clock_real_sleep_ms(struct udiald_clock *c, int ms) {
+	const struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000l};
+	nanosleep(&ts, NULL);
+}
+
+static int udiald_clock_real_poll(struct udiald_clock *c, struct pollfd *fds, nfds_t nfds, int timeout) {
+	return poll(fds, nfds, timeout);
+}
+
+static struct udiald_clock udiald_clock_real = {
+	.now_us = udiald_clock_real_now_us,
+	.sleep_ms = udiald_clock_real_sleep_ms,
+	.poll = udiald_clock_real_poll,
+};
+
+static struct udiald_clock *clock_current = &udiald_clock_real;
+
+/**
+ * Use the given clock from now on, or the real clock when c is NULL.
+ */
+void udiald_clock_set(struct udiald_clock *c) {
+	clock_current = c ? c : &udiald_clock_real;
+}
+
+/**
+ * Returns the current time in microseconds. Only differences between
+ * these values are meaningful.
+ */
+int64_t udiald_clock_now_us(void) {
+	return clock_current->now_us(clock_current);
+}
+
+void udiald_clock_sleep_ms(int ms) {
+	clock_current->sleep_ms(clock_current, ms);
+}
+
+/**
+ * Like poll(2), but waiting according to the current clock.
+ */
+int udiald_clock_poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+	int ret = clock_current->poll(clock_current, fds, nfds, timeout);
+	udiald_trace(UDIALD_TRACE_POLL, nfds ? fds[0].fd : -1, ret, NULL, 0);
+	return ret;
+}
+
+static int64_t udiald_vclock_now_us(struct udiald_clock *c) {
+	return container_of(c, struct udiald_vclock, clock)->now_us;
+}
+
+static int udiald_vclock_poll(struct udiald_clock *c, struct pollfd *fds, nfds_t nfds, int timeout) {
+	struct udiald_vclock *vc = container_of(c, struct udiald_vclock, clock);
+	int64_t deadline = timeout < 0 ? INT64_MAX : vc->now_us + (int64_t)timeout * 1000;
+
+	while (true) {
+		int ret = poll(fds, nfds, 0);
+		if (ret)
+			return ret;
+
+		// Let the peers do whatever is due now and see when
+		// they have something to do next
+		int64_t next = vc->run ? vc->run(vc) : INT64_MAX;
+		if ((ret = poll(fds, nfds, 0)))
+			return ret;
+
+		if (next >= deadline) {
+			if (deadline == INT64_MAX) {
+				// Nothing will ever happen
+				errno = EDEADLK;
+				return -1;
+			}
+			vc->now_us = deadline;
+			return 0;
+		}
+		vc->now_us = next > vc->now_us ? next : vc->now_us + 1;
+	}
+}
+
+static void udiald_vclock_sleep_ms(struct udiald_clock *c, int ms) {
+	udiald_vclock_poll(c, NULL, 0, ms);
+}
+
+/**
+ * Set up a virtual clock, starting at time 0. run is called whenever
+ * a wait would block. It should handle everything that is due at
+ * vc->now_us and return the time of its next event, or INT64_MAX when
+ * it is only waiting for input. Install it with udiald_clock_set.
+ */
+void udiald_vclock_init(struct udiald_vclock *vc, udiald_vclock_run run, void *priv) {
+	vc->clock.now_us = udiald_vclock_now_us;
+	vc->clock.sleep_ms = udiald_vclock_sleep_ms;
+	vc->clock.poll = udiald_vclock_poll;
+	vc->now_us = 0;
+	vc->run = run;
+	vc->priv = priv;
+}
@@ -0,0 +1,384 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Latency histograms and outcome counters per AT command.
+ *
+ * Every command written to a tty is normalized into a key: the "AT"
+ * and trailing "\r" are removed. Arguments are kept, since the same
+ * command can take milliseconds or minutes depending on them (e.g.
+ * AT+COPS=3,0 and the network scan AT+COPS=?), except for PIN commands
+ * (so AT+CPIN="1234" is counted as "+CPIN=" and the PIN never ends up
+ * in the statistics). When the response completes, its latency is
+ * added to a histogram with power-of-two millisecond buckets and the
+ * outcome is counted.
+ *
+ * The histograms are also kept across runs, per configuration profile,
+ * in a latency history file (see udiald_cmdstats_load). Once enough
+ * samples are known for a command, the timeout for its response is
+ * derived from them: UDIALD_CMDSTATS_TIMEOUT_FACTOR times the upper
+ * bound of the bucket containing the 99th percentile. This is never
+ * more than the timeout given by the caller, which stays the upper
+ * bound, nor less than UDIALD_CMDSTATS_TIMEOUT_MIN. Commands counted
+ * as "other" keep the timeout of the caller.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <syslog.h>
+#include "udiald.h"
+
+// Number of distinct commands to keep statistics for. Any further
+// commands are counted together as "other".
+#define UDIALD_CMDSTATS_MAX 64
+// Maximum length of a normalized command
+#define UDIALD_CMDSTATS_KEYLEN 48
+// Histogram buckets: <1ms, <2ms, <4ms, ... <2^(n-2)ms, and the rest
+#define UDIALD_CMDSTATS_BUCKETS 18
+// Number of samples needed before a timeout is adapted
+#define UDIALD_CMDSTATS_MIN_SAMPLES 20
+// Timeout as a multiple of the 99th percentile of the response time
+#define UDIALD_CMDSTATS_TIMEOUT_FACTOR 3
+// Never use a timeout shorter than this (in ms)
+#define UDIALD_CMDSTATS_TIMEOUT_MIN 1000
+// When the history of a command has more samples than this, the
+// counts are halved, so it follows changes in modem behaviour
+#define UDIALD_CMDSTATS_HISTORY_MAX 1000
+
+enum udiald_cmdstats_outcome {
+	UDIALD_CMDSTATS_OK,
+	UDIALD_CMDSTATS_ERROR,	/* ERROR, NO CARRIER, BUSY, ... */
+	UDIALD_CMDSTATS_CME,	/* +CME ERROR / +CMS ERROR */
+	UDIALD_CMDSTATS_TIMEOUT,
+	UDIALD_CMDSTATS_ERANGE,	/* Response too large */
+	UDIALD_CMDSTATS_FAIL,	/* Other I/O errors */
+	UDIALD_CMDSTATS_OUTCOMES
+};
+
+static const char *udiald_cmdstats_outcome_names[UDIALD_CMDSTATS_OUTCOMES] = {
+	[UDIALD_CMDSTATS_OK] = "ok",
+	[UDIALD_CMDSTATS_ERROR] = "error",
+	[UDIALD_CMDSTATS_CME] = "cme",
+	[UDIALD_CMDSTATS_TIMEOUT] = "timeout",
+	[UDIALD_CMDSTATS_ERANGE] = "erange",
+	[UDIALD_CMDSTATS_FAIL] = "fail",
+};
+
+struct udiald_cmdstats_entry {
+	char key[UDIALD_CMDSTATS_KEYLEN];
+	unsigned long outcomes[UDIALD_CMDSTATS_OUTCOMES];
+	unsigned long buckets[UDIALD_CMDSTATS_BUCKETS];
+	uint64_t min_us, max_us, total_us;
+	// Histogram loaded from the history file
+	unsigned long history[UDIALD_CMDSTATS_BUCKETS];
+};
+
+static struct udiald_cmdstats_entry entries[UDIALD_CMDSTATS_MAX];
+static size_t num_entries;
+// The command that was sent last, while its response did not complete
+// yet. We only ever talk to a single tty at a time, but the dialer
+// writes to fd 1 and reads from fd 0, so this is not kept per fd.
+static struct udiald_cmdstats_entry *pending;
+static uint64_t pending_sent_us;
+// History file and the profile to use it for, if loaded
+static char *history_path;
+static char *history_profile;
+
+// Normalize the command in iov into key (see above)
+static void udiald_cmdstats_key(const struct iovec *iov, int iovcnt, char key[static UDIALD_CMDSTATS_KEYLEN]) {
+	size_t len = 0, pos = 0;
+	bool args = false;
+	for (int i = 0; i < iovcnt; ++i) {
+		const char *c = iov[i].iov_base;
+		for (size_t j = 0; j < iov[i].iov_len; ++j, ++pos) {
+			// Leading "AT"
+			if (pos < 2 && (c[j] == "AT"[pos] || c[j] == "at"[pos]))
+				continue;
+			// Arguments extend until the next command
+			if (c[j] == ';')
+				args = false;
+			if (args || c[j] == '\r' || c[j] == '\n')
+				continue;
+			// Leave out the arguments of PIN commands (the
+			// same ones udiald_util_redact masks)
+			if (c[j] == '=' && len >= 3 && !strncmp(key + len - 3, "PIN", 3))
+				args = true;
+			if (len < UDIALD_CMDSTATS_KEYLEN - 1)
+				key[len++] = c[j];
+		}
+	}
+	key[len] = '\0';
+}
+
+static struct udiald_cmdstats_entry *udiald_cmdstats_lookup(const char *key) {
+	for (size_t i = 0; i < num_entries; ++i)
+		if (!strcmp(entries[i].key, key))
+			return &entries[i];
+
+	// Keep the last entry for everything else
+	if (num_entries >= UDIALD_CMDSTATS_MAX - 1) {
+		key = "other";
+		for (size_t i = 0; i < num_entries; ++i)
+			if (!strcmp(entries[i].key, key))
+				return &entries[i];
+	}
+	struct udiald_cmdstats_entry *e = &entries[num_entries++];
+	snprintf(e->key, sizeof(e->key), "%s", key);
+	return e;
+}
+
+/**
+ * Note that the command in iov was written, which starts timing its
+ * response. Called by udiald_tty_putv.
+ */
+void udiald_cmdstats_sent(const struct iovec *iov, int iovcnt) {
+	char key[UDIALD_CMDSTATS_KEYLEN];
+	udiald_cmdstats_key(iov, iovcnt, key);
+	pending = udiald_cmdstats_lookup(key);
+	pending_sent_us = udiald_clock_now_us();
+}
+
+/**
+ * Record the outcome of the last command sent. res is the result from
+ * udiald_tty_get, err the errno value that came with it.
+ */
+void udiald_cmdstats_done(enum udiald_atres res, int err) {
+	struct udiald_cmdstats_entry *e = pending;
+	// Responses without a command (e.g. waiting for a URC) are not
+	// counted
+	if (!e)
+		return;
+	pending = NULL;
+
+	enum udiald_cmdstats_outcome outcome;
+	if (res == UDIALD_AT_OK || res == UDIALD_AT_CONNECT)
+		outcome = UDIALD_CMDSTATS_OK;
+	else if (res == UDIALD_AT_CMEERROR || res == UDIALD_AT_CMSERROR)
+		outcome = UDIALD_CMDSTATS_CME;
+	else if (res != UDIALD_FAIL)
+		outcome = UDIALD_CMDSTATS_ERROR;
+	else if (err == ETIMEDOUT)
+		outcome = UDIALD_CMDSTATS_TIMEOUT;
+	else if (err == ERANGE)
+		outcome = UDIALD_CMDSTATS_ERANGE;
+	else
+		outcome = UDIALD_CMDSTATS_FAIL;
+	e->outcomes[outcome]++;
+
+	uint64_t us = udiald_clock_now_us() - pending_sent_us;
+	size_t bucket = 0;
+	for (uint64_t ms = us / 1000; ms && bucket < UDIALD_CMDSTATS_BUCKETS - 1; ms >>= 1)
+		bucket++;
+	e->buckets[bucket]++;
+
+	if (!e->min_us || us < e->min_us)
+		e->min_us = us;
+	if (us > e->max_us)
+		e->max_us = us;
+	e->total_us += us;
+}
+
+/**
+ * Log a summary of all statistics collected so far, one line per
+ * command, with the given syslog priority.
+ */
+void udiald_cmdstats_dump(int priority) {
+	for (size_t i = 0; i < num_entries; ++i) {
+		struct udiald_cmdstats_entry *e = &entries[i];
+		char b[512];
+		size_t len = 0, count = 0;
+
+		for (size_t o = 0; o < UDIALD_CMDSTATS_OUTCOMES; ++o) {
+			count += e->outcomes[o];
+			if (e->outcomes[o])
+				len += snprintf(b + len, sizeof(b) - len, "%s %lu, ",
+					udiald_cmdstats_outcome_names[o], e->outcomes[o]);
+		}
+		if (!count)
+			continue;
+
+		len += snprintf(b + len, sizeof(b) - len, "min/avg/max %llu/%llu/%llu ms, histogram",
+			(unsigned long long)e->min_us / 1000,
+			(unsigned long long)(e->total_us / count) / 1000,
+			(unsigned long long)e->max_us / 1000);
+		for (size_t h = 0; h < UDIALD_CMDSTATS_BUCKETS && len < sizeof(b); ++h) {
+			if (!e->buckets[h])
+				continue;
+			if (h == UDIALD_CMDSTATS_BUCKETS - 1)
+				len += snprintf(b + len, sizeof(b) - len, " >=%lu:%lu", 1ul << (h - 1), e->buckets[h]);
+			else
+				len += snprintf(b + len, sizeof(b) - len, " <%lu:%lu", 1ul << h, e->buckets[h]);
+		}
+		udiald_log(priority, "AT%s: %s", e->key, b);
+	}
+}
+
+/**
+ * Returns the timeout (in ms) to use for the response to the command
+ * sent last, given the timeout the caller would use. See above.
+ */
+int udiald_cmdstats_timeout(int timeout) {
+	struct udiald_cmdstats_entry *e = pending;
+	// Unrelated commands end up in "other", so its samples say
+	// nothing about this one
+	if (!e || !strcmp(e->key, "other"))
+		return timeout;
+
+	unsigned long total = 0, seen = 0;
+	for (size_t h = 0; h < UDIALD_CMDSTATS_BUCKETS; ++h)
+		total += e->history[h] + e->buckets[h];
+	if (total < UDIALD_CMDSTATS_MIN_SAMPLES)
+		return timeout;
+
+	size_t h;
+	for (h = 0; h < UDIALD_CMDSTATS_BUCKETS - 1; ++h) {
+		seen += e->history[h] + e->buckets[h];
+		if (seen * 100 >= total * 99)
+			break;
+	}
+	// The last bucket has no upper bound
+	if (h == UDIALD_CMDSTATS_BUCKETS - 1)
+		return timeout;
+
+	long adapted = (1l << h) * UDIALD_CMDSTATS_TIMEOUT_FACTOR;
+	if (adapted < UDIALD_CMDSTATS_TIMEOUT_MIN)
+		adapted = UDIALD_CMDSTATS_TIMEOUT_MIN;
+	if (adapted >= timeout)
+		return timeout;
+	udiald_log(LOG_DEBUG, "Using timeout of %ld ms for AT%s (p99 < %lu ms)", adapted, e->key, 1ul << h);
+	return adapted;
+}
+
+// Parse a line from the history file. Returns the key and fills
+// counts, or returns NULL when the line is not for the given profile.
+static char *udiald_cmdstats_parse_history(char *line, const char *profile, unsigned long counts[static UDIALD_CMDSTATS_BUCKETS]) {
+	char *save, *p = strtok_r(line, "\t\n", &save);
+	char *key = strtok_r(NULL, "\t\n", &save);
+	char *c = strtok_r(NULL, "\t\n", &save);
+	if (!p || !key || !c || strcmp(p, profile))
+		return NULL;
+
+	for (size_t h = 0; h < UDIALD_CMDSTATS_BUCKETS; ++h)
+		counts[h] = strtoul(c, &c, 10);
+	return key;
+}
+
+/**
+ * Load the latency history for the given profile from path. This
+ * history is used to adapt timeouts, and the samples from this run are
+ * added to it by udiald_cmdstats_save.
+ *
+ * The file has a line per profile and command, with the profile name,
+ * the normalized command and the bucket counts, separated by tabs.
+ */
+void udiald_cmdstats_load(const char *path, const char *profile) {
+	free(history_path);
+	free(history_profile);
+	history_path = strdup(path);
+	history_profile = strdup(profile);
+
+	FILE *fp = fopen(path, "r");
+	if (!fp)
+		return;
+
+	char line[512];
+	unsigned long counts[UDIALD_CMDSTATS_BUCKETS];
+	while (fgets(line, sizeof(line), fp)) {
+		char *key = udiald_cmdstats_parse_history(line, profile, counts);
+		if (!key)
+			continue;
+		struct udiald_cmdstats_entry *e = udiald_cmdstats_lookup(key);
+		for (size_t h = 0; h < UDIALD_CMDSTATS_BUCKETS; ++h)
+			e->history[h] += counts[h];
+	}
+	fclose(fp);
+}
+
+static void udiald_cmdstats_write_history(FILE *fp, const char *key, unsigned long counts[static UDIALD_CMDSTATS_BUCKETS]) {
+	unsigned long total = 0;
+	for (size_t h = 0; h < UDIALD_CMDSTATS_BUCKETS; ++h)
+		total += counts[h];
+	bool decay = total > UDIALD_CMDSTATS_HISTORY_MAX;
+
+	fprintf(fp, "%s\t%s\t", history_profile, key);
+	for (size_t h = 0; h < UDIALD_CMDSTATS_BUCKETS; ++h)
+		fprintf(fp, h ? " %lu" : "%lu", decay ? counts[h] / 2 : counts[h]);
+	fputc('\n', fp);
+}
+
+/**
+ * Add the samples from this run to the latency history file passed to
+ * udiald_cmdstats_load. The file is read again first, so samples saved
+ * by another process in the meantime (i.e. the dialer) are kept.
+ */
+void udiald_cmdstats_save(void) {
+	if (!history_path)
+		return;
+
+	char tmp[strlen(history_path) + 5];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", history_path);
+	FILE *out = fopen(tmp, "w");
+	if (!out) {
+		udiald_log(LOG_WARNING, "Failed to write latency history %s: %s", tmp, strerror(errno));
+		return;
+	}
+
+	bool saved[UDIALD_CMDSTATS_MAX] = {false};
+	FILE *in = fopen(history_path, "r");
+	if (in) {
+		char line[512], copy[512];
+		unsigned long counts[UDIALD_CMDSTATS_BUCKETS];
+		while (fgets(line, sizeof(line), in)) {
+			memcpy(copy, line, sizeof(copy));
+			char *key = udiald_cmdstats_parse_history(line, history_profile, counts);
+			if (!key) {
+				// Other profiles are kept as they are
+				fputs(copy, out);
+				continue;
+			}
+			for (size_t i = 0; i < num_entries; ++i) {
+				if (!saved[i] && !strcmp(entries[i].key, key)) {
+					for (size_t h = 0; h < UDIALD_CMDSTATS_BUCKETS; ++h)
+						counts[h] += entries[i].buckets[h];
+					saved[i] = true;
+				}
+			}
+			udiald_cmdstats_write_history(out, key, counts);
+		}
+		fclose(in);
+	}
+
+	for (size_t i = 0; i < num_entries; ++i) {
+		unsigned long count = 0;
+		for (size_t h = 0; h < UDIALD_CMDSTATS_BUCKETS; ++h)
+			count += entries[i].buckets[h];
+		if (!saved[i] && count)
+			udiald_cmdstats_write_history(out, entries[i].key, entries[i].buckets);
+	}
+
+	if (fclose(out) || rename(tmp, history_path)) {
+		udiald_log(LOG_WARNING, "Failed to write latency history %s: %s", history_path, strerror(errno));
+		unlink(tmp);
+	}
+	// Do not add the same samples again
+	free(history_path);
+	history_path = NULL;
+}
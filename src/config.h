@@ -2,6 +2,7 @@
 #define UDIALD_CONFIG_H_
 
 #include <libubox/list.h>
+#include <string.h>
 #include "ucix.h"
 
 static inline char* udiald_config_get(struct udiald_state *s, const char *key) {
@@ -34,4 +35,9 @@ static inline void udiald_config_append(struct udiald_state *s, const char *key,
 	ucix_add_list_single(s->uci, s->uciname, s->networkname, key, val);
 }
 
+static inline void udiald_config_save(struct udiald_state *s) {
+	udiald_trace(UDIALD_TRACE_UCI_SAVE, 0, 0, s->uciname, strlen(s->uciname));
+	ucix_save(s->uci, s->uciname);
+}
+
 #endif /* UDIALD_CONFIG_H_ */
@@ -34,6 +34,18 @@
 	[UDIALD_PREFER_GPRS] = "AT^SYSCFG=2,1,3FFFFFFF,2,4\r", \
 }
 
+// Responses to AT^SYSCFG? in each of the modes above (see
+// udiald_parse_match). Only mode and preference are checked, the
+// forced modes do not care about the preference.
+#define HUAWEI_SYSCFG_MODEQUERY "AT^SYSCFG?\r"
+#define HUAWEI_SYSCFG_MODECHECK { \
+	[UDIALD_MODE_AUTO] = "^SYSCFG: 2,0", \
+	[UDIALD_FORCE_UMTS] = "^SYSCFG: 14", \
+	[UDIALD_FORCE_GPRS] = "^SYSCFG: 13", \
+	[UDIALD_PREFER_UMTS] = "^SYSCFG: 2,2", \
+	[UDIALD_PREFER_GPRS] = "^SYSCFG: 2,1", \
+}
+
 // Modesetting commands for ZTE modems
 // Values are cm_mode,net_sel_mode,pref_acq
 // cm_mode=0: Automatic
@@ -51,6 +63,17 @@
 	[UDIALD_PREFER_GPRS] = "AT+ZSNT=0,0,1\r", \
 }
 
+// Responses to AT+ZSNT? in each of the modes above, skipping the
+// read-only net_sel_mode
+#define ZTE_ZSNT_MODEQUERY "AT+ZSNT?\r"
+#define ZTE_ZSNT_MODECHECK { \
+	[UDIALD_MODE_AUTO] = "+ZSNT: 0,*,0", \
+	[UDIALD_FORCE_UMTS] = "+ZSNT: 2", \
+	[UDIALD_FORCE_GPRS] = "+ZSNT: 1", \
+	[UDIALD_PREFER_UMTS] = "+ZSNT: 0,*,2", \
+	[UDIALD_PREFER_GPRS] = "+ZSNT: 0,*,1", \
+}
+
 /* Make sure that the correct ordering of this array is observed: First
  * specific devices, then generic per-vendor profiles and lastly generic
  * per-driver profiles.
@@ -77,6 +100,12 @@ static const struct udiald_profile profiles[] = {
 				[UDIALD_FORCE_UMTS] = "AT+CFUN=6\r",
 				[UDIALD_FORCE_GPRS] = "AT+CFUN=5\r",
 			},
+			.modequery = "AT+CFUN?\r",
+			.modecheck = {
+				[UDIALD_MODE_AUTO] = "+CFUN: 1",
+				[UDIALD_FORCE_UMTS] = "+CFUN: 6",
+				[UDIALD_FORCE_GPRS] = "+CFUN: 5",
+			},
 			.dialcmd = "ATD*99***1#\r",
 		},
 	},
@@ -93,6 +122,11 @@ static const struct udiald_profile profiles[] = {
 				[UDIALD_MODE_AUTO] = "",
 			},
 			.dialcmd = "ATD*99***1#\r",
+			/* Instead of replying NO CARRIER when dialed
+			 * too early, this modem was seen to hang up
+			 * right after sending CONNECT, so keep the
+			 * settle time it always had. */
+			.pin_delay = 5000,
 		},
 	},
 	{
@@ -104,6 +138,8 @@ static const struct udiald_profile profiles[] = {
 			.ctlidx = 2,
 			.datidx = 0,
 			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.modequery = HUAWEI_SYSCFG_MODEQUERY,
+			.modecheck = HUAWEI_SYSCFG_MODECHECK,
 			.dialcmd = "ATD*99***1#\r",
 		},
 	},
@@ -116,6 +152,8 @@ static const struct udiald_profile profiles[] = {
 			.ctlidx = 2,
 			.datidx = 0,
 			.modecmd = ZTE_ZSNT_MODECMD,
+			.modequery = ZTE_ZSNT_MODEQUERY,
+			.modecheck = ZTE_ZSNT_MODECHECK,
 			.dialcmd = "ATD*99***1#\r",
 		},
 	},
@@ -138,6 +176,8 @@ static const struct udiald_profile profiles[] = {
 			.ctlidx = 1,
 			.datidx = 0,
 			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.modequery = HUAWEI_SYSCFG_MODEQUERY,
+			.modecheck = HUAWEI_SYSCFG_MODECHECK,
 			.dialcmd = "ATD*99***1#\r",
 		},
 	},
@@ -150,6 +190,8 @@ static const struct udiald_profile profiles[] = {
 			.ctlidx = 1,
 			.datidx = 2,
 			.modecmd = ZTE_ZSNT_MODECMD,
+			.modequery = ZTE_ZSNT_MODEQUERY,
+			.modecheck = ZTE_ZSNT_MODECHECK,
 			.dialcmd = "ATD*99***1#\r",
 		},
 	},
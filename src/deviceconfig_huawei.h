@@ -0,0 +1,2111 @@
+
+// This file is autogenerated by extract-huawei.py. Do not make
+// changes to it directly, change deviceconfig.h instead.
+// Also, don't include this file, include deviceconfig.h.
+
+
+	{
+		.name   = "12D11001",
+		.desc   = "Huawei K3520 / E1752 / E620",
+		.vendor = 0x12d1,
+		.device = 0x1001,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114A8",
+		.desc   = "Huawei 12d1:14a8",
+		.vendor = 0x12d1,
+		.device = 0x14a8,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11003",
+		.desc   = "Huawei E220",
+		.vendor = 0x12d1,
+		.device = 0x1003,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114A9",
+		.desc   = "Huawei 12d1:14a9",
+		.vendor = 0x12d1,
+		.device = 0x14a9,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C1D",
+		.desc   = "Huawei 12d1:1c1d",
+		.vendor = 0x12d1,
+		.device = 0x1c1d,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11004",
+		.desc   = "Huawei 12d1:1004",
+		.vendor = 0x12d1,
+		.device = 0x1004,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11401",
+		.desc   = "Huawei 12d1:1401",
+		.vendor = 0x12d1,
+		.device = 0x1401,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 2,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11402",
+		.desc   = "Huawei 12d1:1402",
+		.vendor = 0x12d1,
+		.device = 0x1402,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11405",
+		.desc   = "Huawei 12d1:1405",
+		.vendor = 0x12d1,
+		.device = 0x1405,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 2,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11406",
+		.desc   = "Huawei 12d1:1406",
+		.vendor = 0x12d1,
+		.device = 0x1406,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11408",
+		.desc   = "Huawei 12d1:1408",
+		.vendor = 0x12d1,
+		.device = 0x1408,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11409",
+		.desc   = "Huawei 12d1:1409",
+		.vendor = 0x12d1,
+		.device = 0x1409,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 3,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1140A",
+		.desc   = "Huawei 12d1:140a",
+		.vendor = 0x12d1,
+		.device = 0x140a,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1140B",
+		.desc   = "Huawei 12d1:140b",
+		.vendor = 0x12d1,
+		.device = 0x140b,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1140C",
+		.desc   = "Huawei 12d1:140c",
+		.vendor = 0x12d1,
+		.device = 0x140c,
+		.cfg = {
+			.ctlidx = 3,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114AA",
+		.desc   = "Huawei 12d1:14aa",
+		.vendor = 0x12d1,
+		.device = 0x14aa,
+		.cfg = {
+			.ctlidx = 3,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1140D",
+		.desc   = "Huawei 12d1:140d",
+		.vendor = 0x12d1,
+		.device = 0x140d,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1140E",
+		.desc   = "Huawei 12d1:140e",
+		.vendor = 0x12d1,
+		.device = 0x140e,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1140F",
+		.desc   = "Huawei 12d1:140f",
+		.vendor = 0x12d1,
+		.device = 0x140f,
+		.cfg = {
+			.ctlidx = 3,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11411",
+		.desc   = "Huawei 12d1:1411",
+		.vendor = 0x12d1,
+		.device = 0x1411,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11412",
+		.desc   = "Huawei 12d1:1412",
+		.vendor = 0x12d1,
+		.device = 0x1412,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11413",
+		.desc   = "Huawei 12d1:1413",
+		.vendor = 0x12d1,
+		.device = 0x1413,
+		.cfg = {
+			.ctlidx = 3,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11414",
+		.desc   = "Huawei 12d1:1414",
+		.vendor = 0x12d1,
+		.device = 0x1414,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11415",
+		.desc   = "Huawei 12d1:1415",
+		.vendor = 0x12d1,
+		.device = 0x1415,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11416",
+		.desc   = "Huawei 12d1:1416",
+		.vendor = 0x12d1,
+		.device = 0x1416,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11417",
+		.desc   = "Huawei 12d1:1417",
+		.vendor = 0x12d1,
+		.device = 0x1417,
+		.cfg = {
+			.ctlidx = 3,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11418",
+		.desc   = "Huawei 12d1:1418",
+		.vendor = 0x12d1,
+		.device = 0x1418,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11419",
+		.desc   = "Huawei 12d1:1419",
+		.vendor = 0x12d1,
+		.device = 0x1419,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1141A",
+		.desc   = "Huawei 12d1:141a",
+		.vendor = 0x12d1,
+		.device = 0x141a,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1141B",
+		.desc   = "Huawei 12d1:141b",
+		.vendor = 0x12d1,
+		.device = 0x141b,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1141C",
+		.desc   = "Huawei 12d1:141c",
+		.vendor = 0x12d1,
+		.device = 0x141c,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1141D",
+		.desc   = "Huawei 12d1:141d",
+		.vendor = 0x12d1,
+		.device = 0x141d,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 2,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1141E",
+		.desc   = "Huawei 12d1:141e",
+		.vendor = 0x12d1,
+		.device = 0x141e,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1141F",
+		.desc   = "Huawei 12d1:141f",
+		.vendor = 0x12d1,
+		.device = 0x141f,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 2,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11420",
+		.desc   = "Huawei 12d1:1420",
+		.vendor = 0x12d1,
+		.device = 0x1420,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11421",
+		.desc   = "Huawei 12d1:1421",
+		.vendor = 0x12d1,
+		.device = 0x1421,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 2,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11422",
+		.desc   = "Huawei 12d1:1422",
+		.vendor = 0x12d1,
+		.device = 0x1422,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11427",
+		.desc   = "Huawei 12d1:1427",
+		.vendor = 0x12d1,
+		.device = 0x1427,
+		.cfg = {
+			.ctlidx = 3,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11428",
+		.desc   = "Huawei 12d1:1428",
+		.vendor = 0x12d1,
+		.device = 0x1428,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11429",
+		.desc   = "Huawei 12d1:1429",
+		.vendor = 0x12d1,
+		.device = 0x1429,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1142A",
+		.desc   = "Huawei 12d1:142a",
+		.vendor = 0x12d1,
+		.device = 0x142a,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11448",
+		.desc   = "Huawei 12d1:1448",
+		.vendor = 0x12d1,
+		.device = 0x1448,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11433",
+		.desc   = "Huawei E173",
+		.vendor = 0x12d1,
+		.device = 0x1433,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11434",
+		.desc   = "Huawei 12d1:1434",
+		.vendor = 0x12d1,
+		.device = 0x1434,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11436",
+		.desc   = "Huawei 12d1:1436",
+		.vendor = 0x12d1,
+		.device = 0x1436,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11438",
+		.desc   = "Huawei 12d1:1438",
+		.vendor = 0x12d1,
+		.device = 0x1438,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11439",
+		.desc   = "Huawei 12d1:1439",
+		.vendor = 0x12d1,
+		.device = 0x1439,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1143A",
+		.desc   = "Huawei 12d1:143a",
+		.vendor = 0x12d1,
+		.device = 0x143a,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1143B",
+		.desc   = "Huawei 12d1:143b",
+		.vendor = 0x12d1,
+		.device = 0x143b,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1143E",
+		.desc   = "Huawei 12d1:143e",
+		.vendor = 0x12d1,
+		.device = 0x143e,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114AC",
+		.desc   = "Huawei 12d1:14ac",
+		.vendor = 0x12d1,
+		.device = 0x14ac,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114AB",
+		.desc   = "Huawei 12d1:14ab",
+		.vendor = 0x12d1,
+		.device = 0x14ab,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1144A",
+		.desc   = "Huawei 12d1:144a",
+		.vendor = 0x12d1,
+		.device = 0x144a,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11450",
+		.desc   = "Huawei 12d1:1450",
+		.vendor = 0x12d1,
+		.device = 0x1450,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11451",
+		.desc   = "Huawei 12d1:1451",
+		.vendor = 0x12d1,
+		.device = 0x1451,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11452",
+		.desc   = "Huawei 12d1:1452",
+		.vendor = 0x12d1,
+		.device = 0x1452,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11453",
+		.desc   = "Huawei 12d1:1453",
+		.vendor = 0x12d1,
+		.device = 0x1453,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11454",
+		.desc   = "Huawei 12d1:1454",
+		.vendor = 0x12d1,
+		.device = 0x1454,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11455",
+		.desc   = "Huawei 12d1:1455",
+		.vendor = 0x12d1,
+		.device = 0x1455,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11456",
+		.desc   = "Huawei 12d1:1456",
+		.vendor = 0x12d1,
+		.device = 0x1456,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11457",
+		.desc   = "Huawei 12d1:1457",
+		.vendor = 0x12d1,
+		.device = 0x1457,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11458",
+		.desc   = "Huawei 12d1:1458",
+		.vendor = 0x12d1,
+		.device = 0x1458,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11459",
+		.desc   = "Huawei 12d1:1459",
+		.vendor = 0x12d1,
+		.device = 0x1459,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1145A",
+		.desc   = "Huawei 12d1:145a",
+		.vendor = 0x12d1,
+		.device = 0x145a,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1145B",
+		.desc   = "Huawei 12d1:145b",
+		.vendor = 0x12d1,
+		.device = 0x145b,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1145C",
+		.desc   = "Huawei 12d1:145c",
+		.vendor = 0x12d1,
+		.device = 0x145c,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1145D",
+		.desc   = "Huawei 12d1:145d",
+		.vendor = 0x12d1,
+		.device = 0x145d,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1145E",
+		.desc   = "Huawei 12d1:145e",
+		.vendor = 0x12d1,
+		.device = 0x145e,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1145F",
+		.desc   = "Huawei 12d1:145f",
+		.vendor = 0x12d1,
+		.device = 0x145f,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11460",
+		.desc   = "Huawei 12d1:1460",
+		.vendor = 0x12d1,
+		.device = 0x1460,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11461",
+		.desc   = "Huawei 12d1:1461",
+		.vendor = 0x12d1,
+		.device = 0x1461,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11462",
+		.desc   = "Huawei 12d1:1462",
+		.vendor = 0x12d1,
+		.device = 0x1462,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11463",
+		.desc   = "Huawei 12d1:1463",
+		.vendor = 0x12d1,
+		.device = 0x1463,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11404",
+		.desc   = "Huawei 12d1:1404",
+		.vendor = 0x12d1,
+		.device = 0x1404,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11407",
+		.desc   = "Huawei 12d1:1407",
+		.vendor = 0x12d1,
+		.device = 0x1407,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1142B",
+		.desc   = "Huawei 12d1:142b",
+		.vendor = 0x12d1,
+		.device = 0x142b,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1144B",
+		.desc   = "Huawei 12d1:144b",
+		.vendor = 0x12d1,
+		.device = 0x144b,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11464",
+		.desc   = "Huawei 12d1:1464",
+		.vendor = 0x12d1,
+		.device = 0x1464,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11465",
+		.desc   = "Huawei 12d1:1465",
+		.vendor = 0x12d1,
+		.device = 0x1465,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11466",
+		.desc   = "Huawei 12d1:1466",
+		.vendor = 0x12d1,
+		.device = 0x1466,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11467",
+		.desc   = "Huawei 12d1:1467",
+		.vendor = 0x12d1,
+		.device = 0x1467,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11468",
+		.desc   = "Huawei 12d1:1468",
+		.vendor = 0x12d1,
+		.device = 0x1468,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11469",
+		.desc   = "Huawei 12d1:1469",
+		.vendor = 0x12d1,
+		.device = 0x1469,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1146A",
+		.desc   = "Huawei 12d1:146a",
+		.vendor = 0x12d1,
+		.device = 0x146a,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1146B",
+		.desc   = "Huawei 12d1:146b",
+		.vendor = 0x12d1,
+		.device = 0x146b,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1146C",
+		.desc   = "Huawei 12d1:146c",
+		.vendor = 0x12d1,
+		.device = 0x146c,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1146D",
+		.desc   = "Huawei 12d1:146d",
+		.vendor = 0x12d1,
+		.device = 0x146d,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1146E",
+		.desc   = "Huawei 12d1:146e",
+		.vendor = 0x12d1,
+		.device = 0x146e,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1146F",
+		.desc   = "Huawei 12d1:146f",
+		.vendor = 0x12d1,
+		.device = 0x146f,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11470",
+		.desc   = "Huawei 12d1:1470",
+		.vendor = 0x12d1,
+		.device = 0x1470,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11471",
+		.desc   = "Huawei 12d1:1471",
+		.vendor = 0x12d1,
+		.device = 0x1471,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11472",
+		.desc   = "Huawei 12d1:1472",
+		.vendor = 0x12d1,
+		.device = 0x1472,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11473",
+		.desc   = "Huawei 12d1:1473",
+		.vendor = 0x12d1,
+		.device = 0x1473,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11474",
+		.desc   = "Huawei 12d1:1474",
+		.vendor = 0x12d1,
+		.device = 0x1474,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11475",
+		.desc   = "Huawei 12d1:1475",
+		.vendor = 0x12d1,
+		.device = 0x1475,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11476",
+		.desc   = "Huawei 12d1:1476",
+		.vendor = 0x12d1,
+		.device = 0x1476,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11477",
+		.desc   = "Huawei 12d1:1477",
+		.vendor = 0x12d1,
+		.device = 0x1477,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11478",
+		.desc   = "Huawei 12d1:1478",
+		.vendor = 0x12d1,
+		.device = 0x1478,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11479",
+		.desc   = "Huawei 12d1:1479",
+		.vendor = 0x12d1,
+		.device = 0x1479,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1147A",
+		.desc   = "Huawei 12d1:147a",
+		.vendor = 0x12d1,
+		.device = 0x147a,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1147B",
+		.desc   = "Huawei 12d1:147b",
+		.vendor = 0x12d1,
+		.device = 0x147b,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1147C",
+		.desc   = "Huawei 12d1:147c",
+		.vendor = 0x12d1,
+		.device = 0x147c,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1147D",
+		.desc   = "Huawei 12d1:147d",
+		.vendor = 0x12d1,
+		.device = 0x147d,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1147E",
+		.desc   = "Huawei 12d1:147e",
+		.vendor = 0x12d1,
+		.device = 0x147e,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1147F",
+		.desc   = "Huawei 12d1:147f",
+		.vendor = 0x12d1,
+		.device = 0x147f,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11480",
+		.desc   = "Huawei 12d1:1480",
+		.vendor = 0x12d1,
+		.device = 0x1480,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11481",
+		.desc   = "Huawei 12d1:1481",
+		.vendor = 0x12d1,
+		.device = 0x1481,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114C8",
+		.desc   = "Huawei 12d1:14c8",
+		.vendor = 0x12d1,
+		.device = 0x14c8,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114C9",
+		.desc   = "Huawei 12d1:14c9",
+		.vendor = 0x12d1,
+		.device = 0x14c9,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114CA",
+		.desc   = "Huawei 12d1:14ca",
+		.vendor = 0x12d1,
+		.device = 0x14ca,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114CB",
+		.desc   = "Huawei K4510",
+		.vendor = 0x12d1,
+		.device = 0x14cb,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114CC",
+		.desc   = "Huawei 12d1:14cc",
+		.vendor = 0x12d1,
+		.device = 0x14cc,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11482",
+		.desc   = "Huawei 12d1:1482",
+		.vendor = 0x12d1,
+		.device = 0x1482,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11483",
+		.desc   = "Huawei 12d1:1483",
+		.vendor = 0x12d1,
+		.device = 0x1483,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11484",
+		.desc   = "Huawei 12d1:1484",
+		.vendor = 0x12d1,
+		.device = 0x1484,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11485",
+		.desc   = "Huawei 12d1:1485",
+		.vendor = 0x12d1,
+		.device = 0x1485,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11486",
+		.desc   = "Huawei 12d1:1486",
+		.vendor = 0x12d1,
+		.device = 0x1486,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11487",
+		.desc   = "Huawei 12d1:1487",
+		.vendor = 0x12d1,
+		.device = 0x1487,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11488",
+		.desc   = "Huawei 12d1:1488",
+		.vendor = 0x12d1,
+		.device = 0x1488,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11489",
+		.desc   = "Huawei 12d1:1489",
+		.vendor = 0x12d1,
+		.device = 0x1489,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1148A",
+		.desc   = "Huawei 12d1:148a",
+		.vendor = 0x12d1,
+		.device = 0x148a,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1148B",
+		.desc   = "Huawei 12d1:148b",
+		.vendor = 0x12d1,
+		.device = 0x148b,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11510",
+		.desc   = "Huawei 12d1:1510",
+		.vendor = 0x12d1,
+		.device = 0x1510,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11511",
+		.desc   = "Huawei 12d1:1511",
+		.vendor = 0x12d1,
+		.device = 0x1511,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11512",
+		.desc   = "Huawei 12d1:1512",
+		.vendor = 0x12d1,
+		.device = 0x1512,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11513",
+		.desc   = "Huawei 12d1:1513",
+		.vendor = 0x12d1,
+		.device = 0x1513,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11514",
+		.desc   = "Huawei 12d1:1514",
+		.vendor = 0x12d1,
+		.device = 0x1514,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11515",
+		.desc   = "Huawei 12d1:1515",
+		.vendor = 0x12d1,
+		.device = 0x1515,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11516",
+		.desc   = "Huawei 12d1:1516",
+		.vendor = 0x12d1,
+		.device = 0x1516,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11D03",
+		.desc   = "Huawei 12d1:1d03",
+		.vendor = 0x12d1,
+		.device = 0x1d03,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11D09",
+		.desc   = "Huawei 12d1:1d09",
+		.vendor = 0x12d1,
+		.device = 0x1d09,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11D50",
+		.desc   = "Huawei 12d1:1d50",
+		.vendor = 0x12d1,
+		.device = 0x1d50,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C05",
+		.desc   = "Huawei 12d1:1c05",
+		.vendor = 0x12d1,
+		.device = 0x1c05,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C07",
+		.desc   = "Huawei 12d1:1c07",
+		.vendor = 0x12d1,
+		.device = 0x1c07,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C08",
+		.desc   = "Huawei 12d1:1c08",
+		.vendor = 0x12d1,
+		.device = 0x1c08,
+		.cfg = {
+			.ctlidx = 1,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C0C",
+		.desc   = "Huawei 12d1:1c0c",
+		.vendor = 0x12d1,
+		.device = 0x1c0c,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C0D",
+		.desc   = "Huawei 12d1:1c0d",
+		.vendor = 0x12d1,
+		.device = 0x1c0d,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C0E",
+		.desc   = "Huawei 12d1:1c0e",
+		.vendor = 0x12d1,
+		.device = 0x1c0e,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C0F",
+		.desc   = "Huawei 12d1:1c0f",
+		.vendor = 0x12d1,
+		.device = 0x1c0f,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C10",
+		.desc   = "Huawei 12d1:1c10",
+		.vendor = 0x12d1,
+		.device = 0x1c10,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C11",
+		.desc   = "Huawei 12d1:1c11",
+		.vendor = 0x12d1,
+		.device = 0x1c11,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C12",
+		.desc   = "Huawei 12d1:1c12",
+		.vendor = 0x12d1,
+		.device = 0x1c12,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C13",
+		.desc   = "Huawei 12d1:1c13",
+		.vendor = 0x12d1,
+		.device = 0x1c13,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C14",
+		.desc   = "Huawei 12d1:1c14",
+		.vendor = 0x12d1,
+		.device = 0x1c14,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C15",
+		.desc   = "Huawei 12d1:1c15",
+		.vendor = 0x12d1,
+		.device = 0x1c15,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C16",
+		.desc   = "Huawei 12d1:1c16",
+		.vendor = 0x12d1,
+		.device = 0x1c16,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C23",
+		.desc   = "Huawei 12d1:1c23",
+		.vendor = 0x12d1,
+		.device = 0x1c23,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 2,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11444",
+		.desc   = "Huawei 12d1:1444",
+		.vendor = 0x12d1,
+		.device = 0x1444,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11445",
+		.desc   = "Huawei 12d1:1445",
+		.vendor = 0x12d1,
+		.device = 0x1445,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1144E",
+		.desc   = "Huawei 12d1:144e",
+		.vendor = 0x12d1,
+		.device = 0x144e,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D1144F",
+		.desc   = "Huawei 12d1:144f",
+		.vendor = 0x12d1,
+		.device = 0x144f,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114AE",
+		.desc   = "Huawei 12d1:14ae",
+		.vendor = 0x12d1,
+		.device = 0x14ae,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114AF",
+		.desc   = "Huawei 12d1:14af",
+		.vendor = 0x12d1,
+		.device = 0x14af,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114B0",
+		.desc   = "Huawei 12d1:14b0",
+		.vendor = 0x12d1,
+		.device = 0x14b0,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114B1",
+		.desc   = "Huawei 12d1:14b1",
+		.vendor = 0x12d1,
+		.device = 0x14b1,
+		.cfg = {
+			.ctlidx = 0,
+			.datidx = 1,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114A5",
+		.desc   = "Huawei 12d1:14a5",
+		.vendor = 0x12d1,
+		.device = 0x14a5,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114A6",
+		.desc   = "Huawei 12d1:14a6",
+		.vendor = 0x12d1,
+		.device = 0x14a6,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114A7",
+		.desc   = "Huawei 12d1:14a7",
+		.vendor = 0x12d1,
+		.device = 0x14a7,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C19",
+		.desc   = "Huawei 12d1:1c19",
+		.vendor = 0x12d1,
+		.device = 0x1c19,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D11C1A",
+		.desc   = "Huawei 12d1:1c1a",
+		.vendor = 0x12d1,
+		.device = 0x1c1a,
+		.cfg = {
+			.ctlidx = 3,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114D2",
+		.desc   = "Huawei 12d1:14d2",
+		.vendor = 0x12d1,
+		.device = 0x14d2,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
+
+	{
+		.name   = "12D114D3",
+		.desc   = "Huawei 12d1:14d3",
+		.vendor = 0x12d1,
+		.device = 0x14d3,
+		.cfg = {
+			.ctlidx = 2,
+			.datidx = 0,
+			.modecmd = HUAWEI_SYSCFG_MODECMD,
+			.dialcmd = "ATD*99***1#\r",
+		},
+	},
@@ -29,6 +29,15 @@
 #include "udiald.h"
 #include "config.h"
 
+// Total time to spend dialing, including retries (in ms)
+#define UDIALD_DIAL_TIMEOUT 90000
+// Time to wait before redialing after NO CARRIER (in ms)
+#define UDIALD_DIAL_RETRY_DELAY 5000
+// Interval for polling the packet service registration before dialing (in ms)
+#define UDIALD_DIAL_REG_POLL 250
+// Redials when the network answers NO CARRIER although registered
+#define UDIALD_DIAL_RETRIES 1
+
 static void fatal_error(struct udiald_state *state, const char *fmt, ...) {
 	char buf[256];
 	va_list ap;
@@ -37,32 +46,37 @@ static void fatal_error(struct udiald_state *state, const char *fmt, ...) {
 	vsnprintf(buf, lengthof(buf), fmt, ap);
 	va_end(ap);
 
-	syslog(LOG_ERR, "%s", buf);
+	udiald_log(LOG_ERR, "%s", buf);
 	udiald_config_set(state, "udiald_dial_error_msg", buf);
-	ucix_save(state->uci, state->uciname);
+	udiald_config_save(state);
+}
+
+static void udiald_dial_attempt(struct udiald_tty_dial *dial) {
+	udiald_timing_mark(dial->priv, UDIALD_PHASE_DIAL);
 }
 
 int udiald_dial_main(struct udiald_state *state) {
 	udiald_select_modem(state);
+	udiald_timing_resume(state);
 
 	char *tty = ttyname(0);
 	if (tty && (tty = strrchr(tty, '/')))
 		tty++;
 
-	tcflush(0, TCIFLUSH); // Skip crap
+	udiald_tty_flush(0); // Skip crap
 
 	char b[512];
 	struct udiald_tty_read r;
 
 	// Reset, unecho, ...
-	syslog(LOG_NOTICE, "%s: Preparing to dial", tty);
+	udiald_log(LOG_NOTICE, "%s: Preparing to dial", tty);
 	udiald_tty_put(1, "ATE0\r");
 	if (udiald_tty_get(0, &r, NULL, 2500) != UDIALD_AT_OK) {
 		fatal_error(state, "%s: Error disabling echo (%s)",
 				   tty, (b[0]) ? b : strerror(errno));
 		return UDIALD_EDIAL;
 	}
-	syslog(LOG_NOTICE, "%s: Echo disabled", tty);
+	udiald_log(LOG_NOTICE, "%s: Echo disabled", tty);
 
 	// Reset, unecho, ...
 	udiald_tty_put(1, "ATH\r");
@@ -71,7 +85,7 @@ int udiald_dial_main(struct udiald_state *state) {
 				   tty, (b[0]) ? b : strerror(errno));
 		return UDIALD_EDIAL;
 	}
-	syslog(LOG_NOTICE, "%s: Modem reset", tty);
+	udiald_log(LOG_NOTICE, "%s: Modem reset", tty);
 
 	// Set PDP and APN
 	char *apn = udiald_config_get(state, "udiald_apn");
@@ -96,47 +110,66 @@ int udiald_dial_main(struct udiald_state *state) {
 	snprintf(b, sizeof(b), "AT+CGDCONT=1,\"IP\",\"%s\"\r", apn);
 
 	if (!*apn)
-		syslog(LOG_WARNING, "%s: No apn configured, connection might not work", tty);
-
-	udiald_tty_put(1, b);
-	if (udiald_tty_get(0, &r, NULL, 2500) != UDIALD_AT_OK) {
-		fatal_error(state,  "%s: Failed to set APN (%s)",
-				    tty, r.lines ? udiald_tty_flatten_result(&r) : strerror(errno));
-		return UDIALD_EDIAL;
+		udiald_log(LOG_WARNING, "%s: No apn configured, connection might not work", tty);
+
+	// The connect process usually set up the context already
+	char *pdp_apn = udiald_config_get(state, "pdp_apn");
+	if (pdp_apn && !strcmp(pdp_apn, apn)) {
+		udiald_log(LOG_NOTICE, "%s: Using APN \"%s\". Now dialing...", tty, apn);
+	} else {
+		udiald_tty_put(1, b);
+		if (udiald_tty_get(0, &r, NULL, 2500) != UDIALD_AT_OK) {
+			fatal_error(state,  "%s: Failed to set APN (%s)",
+					    tty, r.lines ? udiald_tty_flatten_result(&r) : strerror(errno));
+			return UDIALD_EDIAL;
+		}
+		udiald_log(LOG_NOTICE, "%s: Selected APN \"%s\". Now dialing...", tty, apn);
 	}
-	syslog(LOG_NOTICE, "%s: Selected APN \"%s\". Now dialing...", tty, apn);
+	free(pdp_apn);
 	free(apn);
 
-	// Dial
-	enum udiald_atres res = UDIALD_AT_NOCARRIER;
-	for (int i = 0; i < 9; ++i) { // Wait 9 * 5s for network
-		tcflush(0, TCIFLUSH);
-		// Linux Driver 4.19.19.00 Tool User Guide.pdf inside
-		// HUAWEI Data Cards Linux Driver suggests that ATD*99#
-		// should generally work for WCDMA and GSM, but ATD#777
-		// is needed for CDMA (EVDO). Alternatively,
-		// AT+GCDATA="PPP",1 (where 1 is the PDP profile set up
-		// wit CGDCONT) is also said to be the official connect
-		// command (ATD is legacy but possibly supported by more
-		// modems).
-		syslog(LOG_INFO, "%s: Using dial command: %s", tty, state->modem.profile->cfg.dialcmd);
-		udiald_tty_put(1, state->modem.profile->cfg.dialcmd);
-		res = udiald_tty_get(0, &r, NULL, 10000);
-		if (res != UDIALD_AT_NOCARRIER && res != UDIALD_AT_OK)
-			break;
-		syslog(LOG_NOTICE, "%s: No carrier. Waiting for network...", tty);
-		sleep(5);
-	}
+	// Linux Driver 4.19.19.00 Tool User Guide.pdf inside
+	// HUAWEI Data Cards Linux Driver suggests that ATD*99#
+	// should generally work for WCDMA and GSM, but ATD#777
+	// is needed for CDMA (EVDO). Alternatively,
+	// AT+GCDATA="PPP",1 (where 1 is the PDP profile set up
+	// wit CGDCONT) is also said to be the official connect
+	// command (ATD is legacy but possibly supported by more
+	// modems).
+	struct udiald_tty_dial dial = {
+		.name = tty,
+		.dialcmd = state->modem.profile->cfg.dialcmd,
+		.deadline = udiald_util_now_ms() + UDIALD_DIAL_TIMEOUT,
+		.retry_delay = UDIALD_DIAL_RETRY_DELAY,
+		.reg_poll = UDIALD_DIAL_REG_POLL,
+		.retries = UDIALD_DIAL_RETRIES,
+		.attempt = udiald_dial_attempt,
+		.priv = state,
+	};
+	enum udiald_atres res = udiald_tty_dial(0, 1, &dial, &r);
+	int err = errno;
+
+	udiald_config_revert(state, "dial_attempts");
+	udiald_config_set_int(state, "dial_attempts", dial.attempts);
+	udiald_config_revert(state, "dial_wait");
+	udiald_config_set_int(state, "dial_wait", dial.wait);
 
 	if (res != UDIALD_AT_CONNECT) {
-		fatal_error(state,  "%s: Failed to connect (%s)", tty,
-				   r.lines ? udiald_tty_flatten_result(&r) : strerror(errno));
+		if (res == UDIALD_FAIL && err == EACCES)
+			fatal_error(state, "%s: Failed to connect (packet service registration denied)", tty);
+		else if (res == UDIALD_FAIL && !dial.attempts)
+			fatal_error(state, "%s: Failed to connect (not registered: %s)", tty,
+					   udiald_regstatus_str(dial.regstat));
+		else
+			fatal_error(state,  "%s: Failed to connect (%s)", tty,
+					   r.lines ? udiald_tty_flatten_result(&r) : strerror(err));
 		return UDIALD_EDIAL;
 	}
 
+	udiald_timing_mark(state, UDIALD_PHASE_CONNECT);
 	udiald_config_set(state, "udiald_state", "connected");
-	ucix_save(state->uci, state->uciname);
+	udiald_config_save(state);
 
-	syslog(LOG_NOTICE, "%s: Connected. Handover to pppd.", tty);
+	udiald_log(LOG_NOTICE, "%s: Connected. Handover to pppd.", tty);
 	return UDIALD_OK;
 }
@@ -0,0 +1,187 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Cache of modem identities.
+ *
+ * The manufacturer, model and capabilities of a modem never change, so
+ * once they were queried they are kept in UDIALD_IDENTITY_CACHE and
+ * used on the next connect instead of asking the modem again. Entries
+ * are keyed by the USB device id (the port the modem is plugged into),
+ * the USB vendor and product id, the USB serial number (when the device
+ * has one) and the configuration profile, so plugging in another stick
+ * of the same model does not reuse the entry of the previous one. The
+ * firmware revision is stored as well once known, so the caller can
+ * tell when the modem was upgraded.
+ *
+ * The file has a line per modem, with the fields of the key, the
+ * firmware revision, the GSM capability and the name, separated by
+ * tabs. Empty fields are allowed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <syslog.h>
+#include "udiald.h"
+
+// Number of modems to remember
+#define UDIALD_IDCACHE_MAX 16
+
+enum udiald_idcache_field {
+	UDIALD_IDCACHE_DEVICE_ID,
+	UDIALD_IDCACHE_USB_ID,
+	UDIALD_IDCACHE_SERIAL,
+	UDIALD_IDCACHE_PROFILE,
+	UDIALD_IDCACHE_FIRMWARE,
+	UDIALD_IDCACHE_GSM,
+	UDIALD_IDCACHE_NAME,
+	UDIALD_IDCACHE_FIELDS
+};
+
+static void udiald_idcache_path(const struct udiald_state *state, char *path, size_t size) {
+	snprintf(path, size, "%s%s", state->root ? state->root : "", UDIALD_IDENTITY_CACHE);
+}
+
+// Split a line into its fields (in place), returns false when it does
+// not have all of them
+static bool udiald_idcache_split(char *line, char *fields[static UDIALD_IDCACHE_FIELDS]) {
+	line[strcspn(line, "\n")] = '\0';
+	for (size_t i = 0; i < UDIALD_IDCACHE_FIELDS; ++i) {
+		fields[i] = strsep(&line, "\t");
+		if (!fields[i])
+			return false;
+	}
+	return true;
+}
+
+// Does the line (split into fields) belong to the given modem?
+static bool udiald_idcache_match(char *fields[static UDIALD_IDCACHE_FIELDS], const struct udiald_state *state, const struct udiald_identity *id) {
+	char usb_id[16];
+	snprintf(usb_id, sizeof(usb_id), "%04x:%04x", state->modem.vendor, state->modem.device);
+	return !strcmp(fields[UDIALD_IDCACHE_DEVICE_ID], state->modem.device_id)
+		&& !strcmp(fields[UDIALD_IDCACHE_USB_ID], usb_id)
+		&& !strcmp(fields[UDIALD_IDCACHE_SERIAL], id->serial)
+		&& !strcmp(fields[UDIALD_IDCACHE_PROFILE], state->modem.profile->name);
+}
+
+// Copy a field, leaving out characters that would break up the line
+static void udiald_idcache_copy(char *dst, size_t size, const char *src) {
+	size_t i;
+	for (i = 0; i + 1 < size && src[i]; ++i)
+		dst[i] = (src[i] == '\t' || src[i] == '\n' || src[i] == '\r') ? ' ' : src[i];
+	dst[i] = '\0';
+}
+
+/**
+ * Start an identity for the selected modem: read its USB serial number
+ * from sysfs and clear everything that has to be asked from the modem
+ * (or the cache).
+ */
+void udiald_idcache_init(const struct udiald_state *state, struct udiald_identity *id) {
+	char path[PATH_MAX];
+	memset(id, 0, sizeof(*id));
+
+	snprintf(path, sizeof(path), "%s/sys/bus/usb/devices/%s/serial", state->root ? state->root : "", state->modem.device_id);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+	char buf[sizeof(id->serial)];
+	ssize_t len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0)
+		return;
+	while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == ' '))
+		len--;
+	buf[len] = '\0';
+	udiald_idcache_copy(id->serial, sizeof(id->serial), buf);
+}
+
+/**
+ * Look up the identity of the selected modem, which must have been set
+ * up with udiald_idcache_init. Returns whether it was found, in which
+ * case the firmware revision (if known), name and capabilities are
+ * filled in.
+ */
+bool udiald_idcache_lookup(const struct udiald_state *state, struct udiald_identity *id) {
+	char path[PATH_MAX], line[1024];
+	char *fields[UDIALD_IDCACHE_FIELDS];
+	bool found = false;
+
+	udiald_idcache_path(state, path, sizeof(path));
+	FILE *fp = fopen(path, "r");
+	if (!fp)
+		return false;
+	while (!found && fgets(line, sizeof(line), fp)) {
+		if (!udiald_idcache_split(line, fields) || !udiald_idcache_match(fields, state, id))
+			continue;
+		udiald_idcache_copy(id->firmware, sizeof(id->firmware), fields[UDIALD_IDCACHE_FIRMWARE]);
+		udiald_idcache_copy(id->name, sizeof(id->name), fields[UDIALD_IDCACHE_NAME]);
+		id->gsm = !strcmp(fields[UDIALD_IDCACHE_GSM], "1");
+		found = true;
+	}
+	fclose(fp);
+	return found && id->name[0];
+}
+
+/**
+ * Store the identity of the selected modem, replacing whatever was
+ * stored for its USB device id before. The oldest entries are dropped
+ * once there are more than UDIALD_IDCACHE_MAX.
+ */
+void udiald_idcache_store(const struct udiald_state *state, const struct udiald_identity *id) {
+	char path[PATH_MAX], tmp[PATH_MAX + 4];
+	udiald_idcache_path(state, path, sizeof(path));
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+	FILE *out = fopen(tmp, "w");
+	if (!out) {
+		udiald_log(LOG_WARNING, "Failed to write identity cache %s: %s", tmp, strerror(errno));
+		return;
+	}
+
+	// Most recent first
+	fprintf(out, "%s\t%04x:%04x\t%s\t%s\t%s\t%d\t%s\n", state->modem.device_id,
+		state->modem.vendor, state->modem.device, id->serial,
+		state->modem.profile->name, id->firmware, id->gsm, id->name);
+
+	FILE *in = fopen(path, "r");
+	if (in) {
+		char line[1024], copy[1024];
+		char *fields[UDIALD_IDCACHE_FIELDS];
+		size_t n = 1;
+		while (n < UDIALD_IDCACHE_MAX && fgets(line, sizeof(line), in)) {
+			memcpy(copy, line, sizeof(copy));
+			if (!udiald_idcache_split(line, fields)
+			|| !strcmp(fields[UDIALD_IDCACHE_DEVICE_ID], state->modem.device_id))
+				continue;
+			fputs(copy, out);
+			n++;
+		}
+		fclose(in);
+	}
+
+	if (fclose(out) || rename(tmp, path)) {
+		udiald_log(LOG_WARNING, "Failed to write identity cache %s: %s", path, strerror(errno));
+		unlink(tmp);
+	}
+}
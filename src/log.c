@@ -0,0 +1,247 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Logging backend.
+ *
+ * udiald_log (see udiald.h) checks the log mask before anything is
+ * formatted, so the arguments of masked messages are not even
+ * evaluated. Messages that pass are rate limited per format string:
+ * after UDIALD_LOG_BURST messages with the same format within
+ * UDIALD_LOG_INTERVAL ms, further ones are counted and reported as a
+ * single line once the interval is over. Debug messages are never rate
+ * limited, since they are only enabled on request, and neither is
+ * anything logged after udiald_log_setlimit(false) (e.g. when probing).
+ *
+ * Once udiald_log_open has been called, formatted messages are put in
+ * a queue and passed to syslog() by a writer thread, so a slow or
+ * blocked syslog socket (or stderr, with LOG_PERROR) does not hold up
+ * talking to the modem. When the queue is full, messages are dropped
+ * and counted instead of waiting. Before that (and in tools and
+ * benchmarks) messages are passed to syslog() directly.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include "udiald.h"
+
+// Number of messages the queue can hold
+#define UDIALD_LOG_QUEUE 128
+// Maximum length of a single message (longer ones are truncated)
+#define UDIALD_LOG_MSGLEN 256
+// Messages with the same format allowed per interval
+#define UDIALD_LOG_BURST 10
+// Rate limiting interval (in ms)
+#define UDIALD_LOG_INTERVAL 10000
+// Number of format strings tracked for rate limiting
+#define UDIALD_LOG_RATE_SLOTS 32
+
+struct udiald_log_msg {
+	int priority;
+	char text[UDIALD_LOG_MSGLEN];
+};
+
+struct udiald_log_rate {
+	const char *fmt;
+	int64_t start;		/* Start of the current interval */
+	unsigned count;		/* Messages in the current interval */
+	unsigned suppressed;
+};
+
+int udiald_log_mask = LOG_UPTO(LOG_DEBUG);
+
+static struct udiald_log_rate rates[UDIALD_LOG_RATE_SLOTS];
+static bool ratelimit = true;
+
+static struct udiald_log_msg queue[UDIALD_LOG_QUEUE];
+static size_t queue_head, queue_len;
+static unsigned long dropped;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t writer;
+static bool writer_running, writer_stop;
+
+static void *udiald_log_writer(void *arg) {
+	struct udiald_log_msg msg;
+	unsigned long lost;
+	bool have_msg;
+
+	pthread_mutex_lock(&queue_lock);
+	while (true) {
+		while (!queue_len && !dropped && !writer_stop)
+			pthread_cond_wait(&queue_cond, &queue_lock);
+		if (!queue_len && !dropped)
+			break;
+
+		lost = dropped;
+		dropped = 0;
+		have_msg = queue_len;
+		if (have_msg) {
+			msg = queue[queue_head];
+			queue_head = (queue_head + 1) % UDIALD_LOG_QUEUE;
+			queue_len--;
+		}
+		pthread_mutex_unlock(&queue_lock);
+
+		// Only this thread waits for syslog
+		if (lost)
+			syslog(LOG_WARNING, "Dropped %lu log messages", lost);
+		if (have_msg)
+			syslog(msg.priority, "%s", msg.text);
+
+		pthread_mutex_lock(&queue_lock);
+	}
+	pthread_mutex_unlock(&queue_lock);
+	return NULL;
+}
+
+/**
+ * Open the log (like openlog(3)) with the given mask (like
+ * setlogmask(3)) and start passing messages to syslog in the
+ * background. Messages still queued are written on exit.
+ */
+void udiald_log_open(const char *ident, int option, int facility, int mask) {
+	openlog(ident, option, facility);
+	udiald_log_setmask(mask);
+
+	if (writer_running)
+		return;
+
+	// Signals must go to the main thread, where they interrupt the
+	// event loop. The writer inherits the signal mask, so block them
+	// all while starting it.
+	sigset_t all, old;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	int err = pthread_create(&writer, NULL, udiald_log_writer, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (err) {
+		syslog(LOG_WARNING, "Failed to start log writer, logging directly");
+		return;
+	}
+	writer_running = true;
+	atexit(udiald_log_close);
+}
+
+/**
+ * Write all queued messages and stop the writer thread. Logging
+ * continues directly after this.
+ */
+void udiald_log_close(void) {
+	if (!writer_running)
+		return;
+	pthread_mutex_lock(&queue_lock);
+	writer_stop = true;
+	pthread_cond_signal(&queue_cond);
+	pthread_mutex_unlock(&queue_lock);
+	pthread_join(writer, NULL);
+	writer_running = writer_stop = false;
+}
+
+/**
+ * Only log messages with the priorities in mask from now on.
+ */
+void udiald_log_setmask(int mask) {
+	udiald_log_mask = mask;
+	setlogmask(mask);
+}
+
+/**
+ * Enable or disable rate limiting of messages above debug level.
+ */
+void udiald_log_setlimit(bool enable) {
+	ratelimit = enable;
+}
+
+// Returns whether a message with the given format can be logged now.
+// When a suppressed message is due to be reported, its count is
+// stored in suppressed.
+static bool udiald_log_ratelimit(const char *fmt, unsigned *suppressed) {
+	struct udiald_log_rate *r = &rates[((uintptr_t)fmt >> 3) % UDIALD_LOG_RATE_SLOTS];
+	int64_t now = udiald_util_now_ms();
+
+	*suppressed = 0;
+	if (r->fmt != fmt || now - r->start >= UDIALD_LOG_INTERVAL) {
+		// Only report suppressed messages of our own format,
+		// others sharing the slot are rare enough to ignore
+		if (r->fmt == fmt)
+			*suppressed = r->suppressed;
+		r->fmt = fmt;
+		r->start = now;
+		r->count = 0;
+		r->suppressed = 0;
+	}
+	if (r->count >= UDIALD_LOG_BURST) {
+		r->suppressed++;
+		return false;
+	}
+	r->count++;
+	return true;
+}
+
+static void udiald_log_queue(int priority, const char *text) {
+	if (!writer_running) {
+		syslog(priority, "%s", text);
+		return;
+	}
+
+	pthread_mutex_lock(&queue_lock);
+	if (queue_len == UDIALD_LOG_QUEUE) {
+		dropped++;
+	} else {
+		struct udiald_log_msg *msg = &queue[(queue_head + queue_len) % UDIALD_LOG_QUEUE];
+		msg->priority = priority;
+		snprintf(msg->text, sizeof(msg->text), "%s", text);
+		queue_len++;
+	}
+	pthread_cond_signal(&queue_cond);
+	pthread_mutex_unlock(&queue_lock);
+}
+
+/**
+ * Format and log a message. Use udiald_log instead, which only calls
+ * this when the priority is not masked.
+ */
+void udiald_log_write(int priority, const char *fmt, ...) {
+	char text[UDIALD_LOG_MSGLEN];
+	unsigned suppressed = 0;
+	va_list ap;
+	// Keep errno for the caller (e.g. to use it after logging)
+	int err = errno;
+
+	if (ratelimit && LOG_PRI(priority) < LOG_DEBUG
+	&& !udiald_log_ratelimit(fmt, &suppressed))
+		return;
+
+	if (suppressed) {
+		snprintf(text, sizeof(text), "Suppressed %u messages like: %s", suppressed, fmt);
+		udiald_log_queue(priority, text);
+	}
+
+	va_start(ap, fmt);
+	vsnprintf(text, sizeof(text), fmt, ap);
+	va_end(ap);
+	udiald_log_queue(priority, text);
+	errno = err;
+}
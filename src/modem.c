@@ -28,7 +28,7 @@
 
 #include "deviceconfig.h"
 
-#define UDIALD_SYS_USB_DEVICES "/sys/bus/usb/devices/*"
+#define UDIALD_SYS_USB_DEVICES "/sys/bus/usb/devices/"
 
 static const char *modestr[] = {
 	[UDIALD_MODE_AUTO] = "auto",
@@ -59,7 +59,7 @@ enum udiald_mode udiald_modem_modeval(const char *mode) {
 static int match_profile(struct udiald_modem *modem, const struct udiald_profile *p, const char *profile_name) {
 	if (profile_name && !strcmp(p->name, profile_name)) {
 		modem->profile = p;
-		syslog(LOG_NOTICE, "%s: Selected requested configuration profile \"%s\" (%s)", modem->device_id, p->name, p->desc);
+		udiald_log(LOG_NOTICE, "%s: Selected requested configuration profile \"%s\" (%s)", modem->device_id, p->name, p->desc);
 		return UDIALD_OK;
 	}
 	if (!profile_name
@@ -69,12 +69,12 @@ static int match_profile(struct udiald_modem *modem, const struct udiald_profile
 		modem->profile = p;
 
 		if (p->vendor)
-			syslog(LOG_INFO, "%s: Matched USB vendor id 0x%x", modem->device_id, p->vendor);
+			udiald_log(LOG_INFO, "%s: Matched USB vendor id 0x%x", modem->device_id, p->vendor);
 		if (p->device)
-			syslog(LOG_INFO, "%s: Matched USB product id 0x%x", modem->device_id, p->device);
+			udiald_log(LOG_INFO, "%s: Matched USB product id 0x%x", modem->device_id, p->device);
 		if (p->driver)
-			syslog(LOG_INFO, "%s: Matched driver name \"%s\"", modem->device_id, p->driver);
-		syslog(LOG_NOTICE, "%s: Autoselected configuration profile \"%s\" (%s)", modem->device_id, p->name, p->desc);
+			udiald_log(LOG_INFO, "%s: Matched driver name \"%s\"", modem->device_id, p->driver);
+		udiald_log(LOG_NOTICE, "%s: Autoselected configuration profile \"%s\" (%s)", modem->device_id, p->name, p->desc);
 		return UDIALD_OK;
 	}
 	return UDIALD_ENODEV;
@@ -88,7 +88,7 @@ static int match_profile(struct udiald_modem *modem, const struct udiald_profile
  * was no applicable profile.
  */
 static int udiald_modem_find_profile(const struct udiald_state *state, struct udiald_modem *modem, const char *profile_name) {
-        syslog(LOG_INFO, "%s: Looking for matching profile", modem->device_id);
+        udiald_log(LOG_INFO, "%s: Looking for matching profile", modem->device_id);
 	// Match profiles loaded from uci first
 	struct udiald_profile_list *l;
 	list_for_each_entry(l, &state->custom_profiles, h) {
@@ -103,7 +103,7 @@ static int udiald_modem_find_profile(const struct udiald_state *state, struct ud
 		if (match_profile(modem, &profiles[i], profile_name) == UDIALD_OK)
 			return UDIALD_OK;
 	}
-        syslog(LOG_INFO, "%s: No matching profile found", modem->device_id);
+        udiald_log(LOG_INFO, "%s: No matching profile found", modem->device_id);
 
 	return UDIALD_ENODEV;
 }
@@ -124,21 +124,25 @@ static int udiald_modem_find_profile(const struct udiald_state *state, struct ud
  */
 int udiald_modem_find_devices(const struct udiald_state *state, struct udiald_modem *modem, void func(struct udiald_modem *, void *), void *data, struct udiald_device_filter *filter) {
 	if (func)
-		syslog(LOG_INFO, "Detecting usable devices");
+		udiald_log(LOG_INFO, "Detecting usable devices");
 	else
-		syslog(LOG_INFO, "Detecting first usable device");
+		udiald_log(LOG_INFO, "Detecting first usable device");
 
 	if (filter->flags & UDIALD_FILTER_VENDOR)
-		syslog(LOG_INFO, "Only considering devices with vendor id 0x%x", filter->vendor);
+		udiald_log(LOG_INFO, "Only considering devices with vendor id 0x%x", filter->vendor);
 	if (filter->flags & UDIALD_FILTER_DEVICE)
-		syslog(LOG_INFO, "Only considering devices with product id 0x%x", filter->device);
+		udiald_log(LOG_INFO, "Only considering devices with product id 0x%x", filter->device);
 	if (filter->device_id)
-		syslog(LOG_INFO, "Only considering device with device id %s", filter->device_id);
+		udiald_log(LOG_INFO, "Only considering device with device id %s", filter->device_id);
 
 	bool found = false;
 	glob_t gl;
 	char buf[PATH_MAX + 1];
-	int e = udiald_util_checked_glob(UDIALD_SYS_USB_DEVICES, GLOB_NOSORT, &gl, "listing USB devices");
+	/* When the device id is given, only look at that device
+	 * instead of at every USB device and hub in the system. */
+	snprintf(buf, sizeof(buf), "%s" UDIALD_SYS_USB_DEVICES "%s", state->root ? state->root : "",
+		filter->device_id ? filter->device_id : "*");
+	int e = udiald_util_checked_glob(buf, GLOB_NOSORT, &gl, "listing USB devices");
 	if (e) return e;
 
 	for (size_t i = 0; i < gl.gl_pathc; ++i) {
@@ -151,39 +155,40 @@ int udiald_modem_find_devices(const struct udiald_state *state, struct udiald_mo
 		if (strchr(device_id, ':'))
 			continue;
 
-		/* Check commandline device id. It's a bit inefficient
-		 * to list all devices and apply this filter, instead of
-		 * just constructing the right sysfs path from the
-		 * device id, but this keeps the code a bit simpler for
-		 * now. */
+		/* Check commandline device id (in case it contains
+		 * glob characters) */
 		if (filter->device_id && strcmp(device_id, filter->device_id)) {
-			syslog(LOG_DEBUG, "%s: Skipping device (wrong device id)", device_id);
+			udiald_log(LOG_DEBUG, "%s: Skipping device (wrong device id)", device_id);
 			continue;
 		}
 
-		/* Get the USB vidpid. */
+		/* Get the USB vidpid, checking the commandline vidpid
+		 * filter as soon as possible. */
 		snprintf(buf, sizeof(buf), "%s/%s", path, "idVendor");
 		if (udiald_util_read_hex_word(buf, &modem->vendor)) continue;
+		if ((filter->flags & UDIALD_FILTER_VENDOR) && (filter->vendor != modem->vendor)) {
+			udiald_log(LOG_DEBUG, "%s: Skipping device (vendor 0x%04x) due to commandline filter", device_id, modem->vendor);
+			continue;
+		}
 		snprintf(buf, sizeof(buf), "%s/%s", path, "idProduct");
 		if (udiald_util_read_hex_word(buf, &modem->device)) continue;
-
-		/* Check commandline vidpid filter */
-		if (((filter->flags & UDIALD_FILTER_VENDOR) && (filter->vendor != modem->vendor))
-		|| ((filter->flags & UDIALD_FILTER_DEVICE) && (filter->device != modem->device))) {
-			syslog(LOG_DEBUG, "%s: Skipping device (0x%04x:0x%04x) due to commandline filter", device_id, modem->vendor, modem->device);
+		if ((filter->flags & UDIALD_FILTER_DEVICE) && (filter->device != modem->device)) {
+			udiald_log(LOG_DEBUG, "%s: Skipping device (0x%04x:0x%04x) due to commandline filter", device_id, modem->vendor, modem->device);
 			continue;
 		}
 
-		syslog(LOG_DEBUG, "%s: Considering device (0x%04x:0x%04x)", device_id, modem->vendor, modem->device);
+		udiald_log(LOG_DEBUG, "%s: Considering device (0x%04x:0x%04x)", device_id, modem->vendor, modem->device);
 
 		/* Find out how many tty devices this USB device
-		 * exports. */
-		snprintf(buf, sizeof(buf), "%s/*/tty*", path);
+		 * exports. These live in the interface subdirectories
+		 * (e.g. "1-1:1.0"), so do not look in the others (on a
+		 * hub, that includes every device below it). */
+		snprintf(buf, sizeof(buf), "%s/%s:*/tty*", path, device_id);
 		glob_t gl_tty;
 		int e = udiald_util_checked_glob(buf, 0, &gl_tty, "listing tty devices");
 		if (e) continue; /* No ttys or glob error */
 		modem->num_ttys = gl_tty.gl_pathc;
-		syslog(LOG_DEBUG, "%s: Found %zu tty device%s", device_id, modem->num_ttys, modem->num_ttys != 1 ? "s" : "" );
+		udiald_log(LOG_DEBUG, "%s: Found %zu tty device%s", device_id, modem->num_ttys, modem->num_ttys != 1 ? "s" : "" );
 
 
 		/* Chop off the ttyUSB part, so we keep the path to the
@@ -200,7 +205,7 @@ int udiald_modem_find_devices(const struct udiald_state *state, struct udiald_mo
 		free(subdev);
 
 		udiald_util_read_symlink_basename(buf, modem->driver, sizeof(modem->driver));
-		syslog(LOG_DEBUG, "%s: Detected driver \"%s\"", device_id, modem->driver);
+		udiald_log(LOG_DEBUG, "%s: Detected driver \"%s\"", device_id, modem->driver);
 
 		snprintf(modem->device_id, sizeof(modem->device_id), "%s", device_id);
 
@@ -214,15 +219,15 @@ int udiald_modem_find_devices(const struct udiald_state *state, struct udiald_mo
 			&& modem->profile->cfg.datidx < modem->num_ttys) {
 				snprintf(modem->ctl_tty, sizeof(modem->ctl_tty), "%s", strrchr(gl_tty.gl_pathv[modem->profile->cfg.ctlidx], '/') + 1);
 				snprintf(modem->dat_tty, sizeof(modem->dat_tty), "%s", strrchr(gl_tty.gl_pathv[modem->profile->cfg.datidx], '/') + 1);
-				syslog(LOG_INFO, "%s: Using control tty \"%s\" and data tty \"%s\"", modem->device_id, modem->ctl_tty, modem->dat_tty);
+				udiald_log(LOG_INFO, "%s: Using control tty \"%s\" and data tty \"%s\"", modem->device_id, modem->ctl_tty, modem->dat_tty);
 			} else {
-				syslog(LOG_WARNING, "%s: Profile \"%s\" is invalid, control index (%d) or data index (%d) is more than number largest available tty index (%zu)", modem->device_id, modem->profile->name, modem->profile->cfg.ctlidx, modem->profile->cfg.datidx, modem->num_ttys - 1);
+				udiald_log(LOG_WARNING, "%s: Profile \"%s\" is invalid, control index (%d) or data index (%d) is more than number largest available tty index (%zu)", modem->device_id, modem->profile->name, modem->profile->cfg.ctlidx, modem->profile->cfg.datidx, modem->num_ttys - 1);
 				modem->profile = NULL;
 			}
 		}
 
 		if (modem->profile || !(filter->flags & UDIALD_FILTER_PROFILE)) {
-			syslog(LOG_INFO, "%s: Found usable USB device (0x%04x:0x%04x)", modem->device_id, modem->vendor, modem->device);
+			udiald_log(LOG_INFO, "%s: Found usable USB device (0x%04x:0x%04x)", modem->device_id, modem->vendor, modem->device);
 			found = true;
 
 			/* Call the callback, if any. If there is no
@@ -267,7 +272,18 @@ static struct json_object *profile_to_json(const struct udiald_profile *p) {
 			json_object_object_add(modes, udiald_modem_modestr(mode), json_object_new_string(p->cfg.modecmd[mode]));
 	}
 	json_object_object_add(obj, "modes", modes);
+	if (p->cfg.modequery) {
+		struct json_object *checks = json_object_new_object();
+		for (int mode = 0; mode < UDIALD_NUM_MODES; ++mode) {
+			if (p->cfg.modecheck[mode])
+				json_object_object_add(checks, udiald_modem_modestr(mode), json_object_new_string(p->cfg.modecheck[mode]));
+		}
+		json_object_object_add(obj, "modequery", json_object_new_string(p->cfg.modequery));
+		json_object_object_add(obj, "modechecks", checks);
+	}
 	json_object_object_add(obj, "dialcmd", json_object_new_string(p->cfg.dialcmd));
+	json_object_object_add(obj, "nobatch", json_object_new_boolean(p->cfg.flags & UDIALD_CONFIG_NOBATCH));
+	json_object_object_add(obj, "pin_delay", json_object_new_int(p->cfg.pin_delay));
 
 	return obj;
 }
@@ -309,7 +325,7 @@ static void display_device(struct udiald_modem *modem, void *data) {
  * Detect (potentially) usable devices and list them on stdout.
  */
 int udiald_modem_list_devices(const struct udiald_state *state, struct udiald_device_filter *filter) {
-	syslog(LOG_NOTICE, "Listing usable devices");
+	udiald_log(LOG_NOTICE, "Listing usable devices");
 	/* Allocate some storage for udiald_modem_find_devices to work */
 	struct udiald_modem modem;
 	struct device_display_data data = {
@@ -320,9 +336,9 @@ int udiald_modem_list_devices(const struct udiald_state *state, struct udiald_de
 
 	int e = udiald_modem_find_devices(state, &modem, display_device, &data, filter);
 	if (e == UDIALD_ENODEV) {
-		syslog(LOG_NOTICE, "No devices found");
+		udiald_log(LOG_NOTICE, "No devices found");
 	} else if (e != UDIALD_OK) {
-		syslog(LOG_ERR, "Error while detecting devices");
+		udiald_log(LOG_ERR, "Error while detecting devices");
 	}
 	if (state->format == UDIALD_FORMAT_JSON) {
 		printf("%s\n", json_object_to_json_string_ext(data.data.dict, JSON_C_TO_STRING_PRETTY));
@@ -351,6 +367,14 @@ static int udiald_modem_parse_profile(const struct uci_section *s, struct udiald
 			p->cfg.datidx = strtoul(o->v.string, NULL, 10);
 		else if (!strcmp(o->e.name, "dialcmd"))
 			asprintf(&p->cfg.dialcmd, "%s\r", o->v.string);
+		else if (!strcmp(o->e.name, "modequery"))
+			asprintf(&p->cfg.modequery, "%s\r", o->v.string);
+		else if (!strcmp(o->e.name, "nobatch")) {
+			if (strtoul(o->v.string, NULL, 10))
+				p->cfg.flags |= UDIALD_CONFIG_NOBATCH;
+		}
+		else if (!strcmp(o->e.name, "pin_delay"))
+			p->cfg.pin_delay = strtoul(o->v.string, NULL, 10);
 		else if (!strcmp(o->e.name, "vendor")) {
 			p->vendor = strtoul(o->v.string, NULL, 16);
 			p->flags &= ~UDIALD_PROFILE_NOVENDOR;
@@ -369,13 +393,22 @@ static int udiald_modem_parse_profile(const struct uci_section *s, struct udiald
 					break;
 				}
 			}
+		} else if (!strncmp(o->e.name, "modecheck_", 10) && o->v.string[0]) {
+			/* Name starts with modecheck_ and ends with a
+			 * mode name */
+			for (int i=0; i < UDIALD_NUM_MODES; ++i) {
+				if (!strcmp(o->e.name + 10, udiald_modem_modestr(i))) {
+					p->cfg.modecheck[i] = strdup(o->v.string);
+					break;
+				}
+			}
 		} else {
-			syslog(LOG_INFO, "Uci section %s contains unknown option: %s", s->e.name, o->e.name);
+			udiald_log(LOG_INFO, "Uci section %s contains unknown option: %s", s->e.name, o->e.name);
 		}
 	}
 
 	if (!p->cfg.dialcmd) {
-		syslog(LOG_WARNING, "Uci section %s does not contain a dial command", s->e.name);
+		udiald_log(LOG_WARNING, "Uci section %s does not contain a dial command", s->e.name);
 		return UDIALD_EINVAL;
 	}
 
@@ -384,8 +417,11 @@ static int udiald_modem_parse_profile(const struct uci_section *s, struct udiald
 
 static void udiald_modem_free_profile(struct udiald_profile_list *l) {
 	free(l->p.desc);
-	for (int i=0; i < UDIALD_NUM_MODES; ++i)
+	for (int i=0; i < UDIALD_NUM_MODES; ++i) {
 		free(l->p.cfg.modecmd[i]);
+		free(l->p.cfg.modecheck[i]);
+	}
+	free(l->p.cfg.modequery);
 	free(l->p.cfg.dialcmd);
 	free(l);
 }
@@ -407,7 +443,7 @@ int udiald_modem_load_profiles(struct udiald_state *state) {
 				continue;
 			}
 
-			syslog(LOG_INFO, "Loaded profile \"%s\" from uci", l->p.name);
+			udiald_log(LOG_INFO, "Loaded profile \"%s\" from uci", l->p.name);
 			list_add(&l->h, &state->custom_profiles);
 		}
 	}
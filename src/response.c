@@ -0,0 +1,272 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Parsers for information responses to common AT commands.
+ *
+ * These scan a response line in place, without modifying or copying
+ * it, and fill a struct with the values found. String values point
+ * into the line, so they are only valid as long as the line is.
+ *
+ * All parsers return UDIALD_OK when the line was parsed, or
+ * UDIALD_EINVAL when it does not look like the expected response.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "udiald.h"
+
+// Check that line starts with prefix (e.g. "+CSQ:") and return a
+// pointer to the first non-space character after it, or NULL.
+static const char *udiald_parse_start(const char *line, const char *prefix) {
+	size_t len = strlen(prefix);
+	if (!line || strncmp(line, prefix, len))
+		return NULL;
+	line += len;
+	while (*line == ' ')
+		line++;
+	return line;
+}
+
+// Parse a decimal number at *p and advance *p past it
+static bool udiald_parse_int(const char **p, int *val) {
+	const char *s = *p;
+	int v = 0;
+	if (*s < '0' || *s > '9')
+		return false;
+	while (*s >= '0' && *s <= '9')
+		v = v * 10 + (*s++ - '0');
+	*val = v;
+	*p = s;
+	return true;
+}
+
+// Skip a comma at *p
+static bool udiald_parse_sep(const char **p) {
+	if (**p != ',')
+		return false;
+	(*p)++;
+	return true;
+}
+
+// Parse a quoted string at *p and advance *p past the closing quote
+static bool udiald_parse_quoted(const char **p, struct udiald_str *str) {
+	if (**p != '"')
+		return false;
+	const char *end = strchr(*p + 1, '"');
+	if (!end)
+		return false;
+	str->s = *p + 1;
+	str->len = end - str->s;
+	*p = end + 1;
+	return true;
+}
+
+// Parse a hexadecimal number, which may or may not be quoted
+static bool udiald_parse_hex(const char **p, long *val) {
+	const char *s = *p;
+	bool quoted = (*s == '"');
+	if (quoted)
+		s++;
+	char *end;
+	*val = strtol(s, &end, 16);
+	if (end == s || (quoted && *end != '"'))
+		return false;
+	*p = quoted ? end + 1 : end;
+	return true;
+}
+
+/**
+ * Parse "+CSQ: <rssi>,<ber>". 99 means unknown for both values.
+ */
+int udiald_parse_csq(const char *line, struct udiald_csq *csq) {
+	const char *p = udiald_parse_start(line, "+CSQ:");
+	if (!p
+	|| !udiald_parse_int(&p, &csq->rssi)
+	|| !udiald_parse_sep(&p)
+	|| !udiald_parse_int(&p, &csq->ber))
+		return UDIALD_EINVAL;
+	return UDIALD_OK;
+}
+
+/**
+ * Parse the Huawei "^RSSI:<rssi>" unsolicited result code, which uses
+ * the same scale as +CSQ.
+ */
+int udiald_parse_hw_rssi(const char *line, int *rssi) {
+	const char *p = udiald_parse_start(line, "^RSSI:");
+	if (!p || !udiald_parse_int(&p, rssi))
+		return UDIALD_EINVAL;
+	return UDIALD_OK;
+}
+
+/**
+ * Parse "+COPS: <mode>[,<format>,<oper>[,<AcT>]]". Fields that are not
+ * present are set to -1 (or an empty operator).
+ */
+int udiald_parse_cops(const char *line, struct udiald_cops *cops) {
+	const char *p = udiald_parse_start(line, "+COPS:");
+	cops->format = cops->act = -1;
+	cops->oper.s = NULL;
+	cops->oper.len = 0;
+
+	if (!p || !udiald_parse_int(&p, &cops->mode))
+		return UDIALD_EINVAL;
+	if (!udiald_parse_sep(&p))
+		return *p ? UDIALD_EINVAL : UDIALD_OK;
+	if (!udiald_parse_int(&p, &cops->format)
+	|| !udiald_parse_sep(&p)
+	|| !udiald_parse_quoted(&p, &cops->oper))
+		return UDIALD_EINVAL;
+	if (udiald_parse_sep(&p) && !udiald_parse_int(&p, &cops->act))
+		return UDIALD_EINVAL;
+	return UDIALD_OK;
+}
+
+/**
+ * Parse "+CPIN: <code>" into the SIM state.
+ */
+int udiald_parse_cpin(const char *line, enum udiald_sim_state *sim) {
+	const char *p = udiald_parse_start(line, "+CPIN:");
+	if (!p)
+		return UDIALD_EINVAL;
+
+	if (!strcmp(p, "READY"))
+		*sim = UDIALD_SIM_READY;
+	else if (!strcmp(p, "SIM PIN"))
+		*sim = UDIALD_SIM_PIN;
+	else if (!strcmp(p, "SIM PUK"))
+		*sim = UDIALD_SIM_PUK;
+	else
+		*sim = UDIALD_SIM_OTHER;
+	return UDIALD_OK;
+}
+
+static const struct {
+	const char *name;
+	enum udiald_gcap flag;
+} gcaps[] = {
+	{"+CGSM", UDIALD_GCAP_GSM},
+	{"+CIS707-A", UDIALD_GCAP_CDMA},
+	{"+CIS707", UDIALD_GCAP_CDMA},
+	{"+MS", UDIALD_GCAP_MS},
+	{"+ES", UDIALD_GCAP_ES},
+	{"+DS", UDIALD_GCAP_DS},
+	{"+FCLASS", UDIALD_GCAP_FCLASS},
+};
+
+/**
+ * Parse "+GCAP: <cap>[,<cap>...]" into a bitmask of capabilities.
+ * Unknown capabilities are ignored.
+ */
+int udiald_parse_gcap(const char *line, unsigned *caps) {
+	const char *p = udiald_parse_start(line, "+GCAP:");
+	if (!p)
+		return UDIALD_EINVAL;
+
+	*caps = 0;
+	while (*p) {
+		size_t len = strcspn(p, ",");
+		for (size_t i = 0; i < lengthof(gcaps); ++i) {
+			if (len == strlen(gcaps[i].name) && !strncmp(p, gcaps[i].name, len)) {
+				*caps |= gcaps[i].flag;
+				break;
+			}
+		}
+		p += len;
+		while (*p == ',' || *p == ' ')
+			p++;
+	}
+	return UDIALD_OK;
+}
+
+/**
+ * Parse a network registration report for +CREG, +CGREG or +CEREG (the
+ * prefix is taken from the line). When urc is true, the line is an
+ * unsolicited report ("<stat>[,<lac>,<ci>[,<AcT>]]"), otherwise it is
+ * the response to a query ("<n>,<stat>[,<lac>,<ci>[,<AcT>]]").
+ * Fields that are not present are set to -1.
+ */
+int udiald_parse_creg(const char *line, bool urc, struct udiald_creg *reg) {
+	const char *p = line ? strchr(line, ':') : NULL;
+	if (!p || line[0] != '+')
+		return UDIALD_EINVAL;
+	p++;
+	while (*p == ' ')
+		p++;
+
+	reg->n = reg->act = -1;
+	reg->lac = reg->ci = -1;
+
+	if (!urc && (!udiald_parse_int(&p, &reg->n) || !udiald_parse_sep(&p)))
+		return UDIALD_EINVAL;
+	if (!udiald_parse_int(&p, &reg->stat))
+		return UDIALD_EINVAL;
+	if (!udiald_parse_sep(&p))
+		return *p ? UDIALD_EINVAL : UDIALD_OK;
+	if (!udiald_parse_hex(&p, &reg->lac)
+	|| !udiald_parse_sep(&p)
+	|| !udiald_parse_hex(&p, &reg->ci))
+		return UDIALD_EINVAL;
+	if (udiald_parse_sep(&p) && !udiald_parse_int(&p, &reg->act))
+		return UDIALD_EINVAL;
+	return UDIALD_OK;
+}
+
+static const char *regstatus_str[] = {
+	[UDIALD_REG_NOT_REGISTERED] = "not_registered",
+	[UDIALD_REG_HOME] = "home",
+	[UDIALD_REG_SEARCHING] = "searching",
+	[UDIALD_REG_DENIED] = "denied",
+	[UDIALD_REG_UNKNOWN] = "unknown",
+	[UDIALD_REG_ROAMING] = "roaming",
+};
+
+// Registration status number (from +CREG / +CGREG) -> string
+const char *udiald_regstatus_str(int stat) {
+	if (stat < 0 || stat >= lengthof(regstatus_str))
+		return "unknown";
+	return regstatus_str[stat];
+}
+
+/**
+ * Check whether line matches pattern, comparing comma separated fields
+ * from the start (e.g. pattern "^SYSCFG: 2,0" matches the line
+ * "^SYSCFG: 2,0,3FFFFFFF,1,2"). A field "*" in the pattern matches any
+ * value, fields after the last one in the pattern are not compared and
+ * spaces are ignored.
+ */
+int udiald_parse_match(const char *line, const char *pattern) {
+	const char *l = line, *p = pattern;
+	if (!l)
+		return UDIALD_EINVAL;
+	while (*p) {
+		while (*l == ' ')
+			l++;
+		while (*p == ' ')
+			p++;
+		if (*p == '*' && (p[1] == ',' || !p[1])) {
+			l += strcspn(l, ",");
+			p++;
+		} else if (*p && *l++ != *p++) {
+			return UDIALD_EINVAL;
+		}
+	}
+	return (*l == ',' || !*l) ? UDIALD_OK : UDIALD_EINVAL;
+}
@@ -0,0 +1,138 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Per-phase timing of the connection process.
+ *
+ * The connect process records the CLOCK_MONOTONIC time it started as
+ * "timing_start" in the uci state. Whenever a phase completes, the
+ * number of milliseconds since then is stored as "timing_<phase>".
+ * The dialer (started by pppd) picks up timing_start from the state,
+ * so its phases are relative to the same starting point. Since every
+ * dial attempt is recorded, "timing_dial" is a list.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <syslog.h>
+#include "udiald.h"
+#include "config.h"
+
+static const char *udiald_phase_names[UDIALD_NUM_PHASES] = {
+	[UDIALD_PHASE_SELECT_MODEM] = "select_modem",
+	[UDIALD_PHASE_OPEN_CONTROL] = "open_control",
+	[UDIALD_PHASE_RESET] = "reset",
+	[UDIALD_PHASE_IDENTIFY] = "identify",
+	[UDIALD_PHASE_CHECK_SIM] = "check_sim",
+	[UDIALD_PHASE_ENTER_PIN] = "enter_pin",
+	[UDIALD_PHASE_CONTEXT] = "context",
+	[UDIALD_PHASE_SET_MODE] = "set_mode",
+	[UDIALD_PHASE_PPPD] = "pppd",
+	[UDIALD_PHASE_ATTACH] = "attach",
+	[UDIALD_PHASE_DIAL] = "dial",
+	[UDIALD_PHASE_CONNECT] = "connect",
+	[UDIALD_PHASE_PPP_UP] = "ppp_up",
+};
+
+static void udiald_timing_option(enum udiald_phase phase, char buf[static 32]) {
+	snprintf(buf, 32, "timing_%s", udiald_phase_names[phase]);
+}
+
+/**
+ * Start timing a new connection attempt, clearing the timings of any
+ * previous attempt from the state.
+ */
+void udiald_timing_start(struct udiald_state *state) {
+	char opt[32], val[24];
+	for (enum udiald_phase p = 0; p < UDIALD_NUM_PHASES; ++p) {
+		udiald_timing_option(p, opt);
+		udiald_config_revert(state, opt);
+	}
+
+	state->timing_start = udiald_util_now_ms();
+	snprintf(val, sizeof(val), "%" PRId64, state->timing_start);
+	udiald_config_set(state, "timing_start", val);
+}
+
+/**
+ * Continue timing a connection attempt started by another process
+ * (i.e. the dialer continuing after the connect process). If there is
+ * no timing_start in the state, the current time is used.
+ */
+void udiald_timing_resume(struct udiald_state *state) {
+	char *val = udiald_config_get(state, "timing_start");
+	state->timing_start = val ? strtoll(val, NULL, 10) : udiald_util_now_ms();
+	free(val);
+}
+
+/**
+ * Record that the given phase has just completed. This only changes
+ * the uci state, it is up to the caller to save it.
+ */
+void udiald_timing_mark(struct udiald_state *state, enum udiald_phase phase) {
+	char opt[32];
+	int ms = udiald_util_now_ms() - state->timing_start;
+
+	udiald_timing_option(phase, opt);
+	if (phase == UDIALD_PHASE_DIAL) {
+		char val[16];
+		snprintf(val, sizeof(val), "%d", ms);
+		udiald_config_append(state, opt, val);
+	} else {
+		udiald_config_set_int(state, opt, ms);
+	}
+	udiald_log(LOG_DEBUG, "%s: Phase %s done after %d ms", state->modem.device_id, udiald_phase_names[phase], ms);
+	udiald_trace(UDIALD_TRACE_PHASE, phase, ms, udiald_phase_names[phase], strlen(udiald_phase_names[phase]));
+}
+
+/**
+ * Returns the timings from the uci state as a JSON object. Phases that
+ * were not reached are left out. The state is reloaded first, to pick
+ * up timings recorded by the dialer.
+ */
+struct json_object *udiald_timing_json(struct udiald_state *state) {
+	struct json_object *obj = json_object_new_object();
+	char opt[32];
+
+	udiald_config_save(state);
+	ucix_unload(state->uci, state->uciname);
+
+	for (enum udiald_phase p = 0; p < UDIALD_NUM_PHASES; ++p) {
+		udiald_timing_option(p, opt);
+		if (p == UDIALD_PHASE_DIAL) {
+			struct json_object *attempts = json_object_new_array();
+			LIST_HEAD(list);
+			udiald_config_get_list(state, opt, &list);
+			struct ucilist *item, *tmp;
+			list_for_each_entry_safe(item, tmp, &list, list) {
+				json_object_array_add(attempts, json_object_new_int(atoi(item->val)));
+				free(item->val);
+				free(item);
+			}
+			json_object_object_add(obj, udiald_phase_names[p], attempts);
+		} else {
+			int ms = udiald_config_get_int(state, opt, -1);
+			if (ms >= 0)
+				json_object_object_add(obj, udiald_phase_names[p], json_object_new_int(ms));
+		}
+	}
+	return obj;
+}
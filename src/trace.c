@@ -0,0 +1,262 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * In-memory trace of recent events.
+ *
+ * Events (data sent and received, poll wakeups, phase changes, uci
+ * saves, pppd and signals) are always recorded into a fixed-size ring
+ * of 64 byte entries, which only costs a clock read and a few small
+ * copies per event. Nothing is formatted until the trace is dumped to
+ * a file, which happens on SIGUSR1 and when exiting with an error.
+ *
+ * Events can be recorded from signal handlers, so slots are reserved
+ * with an atomic increment of the head index and every entry carries
+ * the index it was written for, set only once the entry is complete.
+ * The dump checks that index before and after copying an entry and
+ * skips entries that are being written or were overwritten meanwhile.
+ *
+ * Data longer than fits in one entry continues in the next entries
+ * (flagged UDIALD_TRACE_CONT), up to UDIALD_TRACE_MAXLEN bytes. PINs
+ * and PUKs in commands sent are masked before they are recorded.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include "udiald.h"
+
+// Number of entries in the ring (must be a power of two)
+#define UDIALD_TRACE_EVENTS 1024
+// Bytes of data in a single entry
+#define UDIALD_TRACE_DATA 40
+// Maximum bytes of data recorded for a single event
+#define UDIALD_TRACE_MAXLEN (8 * UDIALD_TRACE_DATA)
+
+enum udiald_trace_flags {
+	UDIALD_TRACE_CONT = 1,		/* Continues the data of the previous entry */
+	UDIALD_TRACE_TRUNCATED = 2,	/* Data was longer than UDIALD_TRACE_MAXLEN */
+};
+
+struct udiald_trace_entry {
+	uint32_t seq;		/* Index + 1 once written, 0 while writing */
+	uint8_t type;		/* enum udiald_trace_type */
+	uint8_t flags;		/* enum udiald_trace_flags */
+	uint8_t len;		/* Bytes used in data */
+	int32_t arg;
+	int32_t val;
+	int64_t us;		/* udiald_clock_now_us() */
+	char data[UDIALD_TRACE_DATA];
+};
+
+static const char *udiald_trace_type_names[] = {
+	[UDIALD_TRACE_TX] = "tx",
+	[UDIALD_TRACE_RX] = "rx",
+	[UDIALD_TRACE_POLL] = "poll",
+	[UDIALD_TRACE_WAKEUP] = "wakeup",
+	[UDIALD_TRACE_PHASE] = "phase",
+	[UDIALD_TRACE_UCI_SAVE] = "uci-save",
+	[UDIALD_TRACE_PPPD] = "pppd",
+	[UDIALD_TRACE_SIGNAL] = "signal",
+};
+
+static struct udiald_trace_entry ring[UDIALD_TRACE_EVENTS];
+static uint32_t ring_head;
+// Where to dump the trace, if anywhere
+static char trace_path[PATH_MAX];
+static bool trace_json;
+
+/**
+ * Record an event with the data from the given buffers (which can be
+ * empty). The meaning of arg and val depends on the type, see
+ * enum udiald_trace_type. This is safe to call from a signal handler.
+ */
+void udiald_tracev(enum udiald_trace_type type, int arg, int val, const struct iovec *iov, int iovcnt) {
+	char data[UDIALD_TRACE_MAXLEN];
+	size_t len = 0, total = 0;
+	for (int i = 0; i < iovcnt; ++i) {
+		size_t n = iov[i].iov_len;
+		total += n;
+		if (n > sizeof(data) - len)
+			n = sizeof(data) - len;
+		memcpy(data + len, iov[i].iov_base, n);
+		len += n;
+	}
+	if (type == UDIALD_TRACE_TX)
+		udiald_util_redact(data, len);
+
+	int64_t us = udiald_clock_now_us();
+	uint32_t n = len ? (len + UDIALD_TRACE_DATA - 1) / UDIALD_TRACE_DATA : 1;
+	uint32_t idx = __atomic_fetch_add(&ring_head, n, __ATOMIC_RELAXED);
+
+	for (uint32_t i = 0; i < n; ++i, ++idx) {
+		struct udiald_trace_entry *e = &ring[idx % UDIALD_TRACE_EVENTS];
+		__atomic_store_n(&e->seq, 0, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		size_t off = i * UDIALD_TRACE_DATA;
+		e->type = type;
+		e->flags = i ? UDIALD_TRACE_CONT : 0;
+		if (i == n - 1 && total > len)
+			e->flags |= UDIALD_TRACE_TRUNCATED;
+		e->len = len - off < UDIALD_TRACE_DATA ? len - off : UDIALD_TRACE_DATA;
+		e->arg = arg;
+		e->val = val;
+		e->us = us;
+		memcpy(e->data, data + off, e->len);
+
+		__atomic_store_n(&e->seq, idx + 1, __ATOMIC_RELEASE);
+	}
+}
+
+void udiald_trace(enum udiald_trace_type type, int arg, int val, const void *data, size_t len) {
+	struct iovec iov = {.iov_base = (void *)data, .iov_len = len};
+	udiald_tracev(type, arg, val, &iov, 1);
+}
+
+/**
+ * Set the file udiald_trace_dump writes to, as text or as JSON.
+ */
+void udiald_trace_init(const char *path, bool json) {
+	snprintf(trace_path, sizeof(trace_path), "%s", path);
+	trace_json = json;
+}
+
+// Copy the entry with the given index, returns false if it is not
+// (or no longer) available
+static bool udiald_trace_copy(uint32_t idx, struct udiald_trace_entry *copy) {
+	struct udiald_trace_entry *e = &ring[idx % UDIALD_TRACE_EVENTS];
+	if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != idx + 1)
+		return false;
+	memcpy(copy, e, sizeof(*copy));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&e->seq, __ATOMIC_RELAXED) == idx + 1;
+}
+
+static void udiald_trace_write_text(FILE *fp, const struct udiald_trace_entry *e, const char *data, size_t len) {
+	fprintf(fp, "%lld.%06lld %-8s %d %d", (long long)(e->us / 1000000), (long long)(e->us % 1000000),
+		udiald_trace_type_names[e->type], e->arg, e->val);
+	if (!len && !(e->flags & UDIALD_TRACE_TRUNCATED)) {
+		fputc('\n', fp);
+		return;
+	}
+
+	fputs(" \"", fp);
+	for (size_t i = 0; i < len; ++i) {
+		unsigned char c = data[i];
+		if (c == '\r')
+			fputs("\\r", fp);
+		else if (c == '\n')
+			fputs("\\n", fp);
+		else if (c == '"' || c == '\\')
+			fprintf(fp, "\\%c", c);
+		else if (c < 0x20 || c >= 0x7f)
+			fprintf(fp, "\\x%02x", c);
+		else
+			fputc(c, fp);
+	}
+	fputs(e->flags & UDIALD_TRACE_TRUNCATED ? "\"...\n" : "\"\n", fp);
+}
+
+static void udiald_trace_add_json(struct json_object *events, const struct udiald_trace_entry *e, const char *data, size_t len) {
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "us", json_object_new_int64(e->us));
+	json_object_object_add(obj, "type", json_object_new_string(udiald_trace_type_names[e->type]));
+	json_object_object_add(obj, "arg", json_object_new_int(e->arg));
+	json_object_object_add(obj, "val", json_object_new_int(e->val));
+	if (len)
+		json_object_object_add(obj, "data", json_object_new_string_len(data, len));
+	if (e->flags & UDIALD_TRACE_TRUNCATED)
+		json_object_object_add(obj, "truncated", json_object_new_boolean(true));
+	json_object_array_add(events, obj);
+}
+
+// Write out a single event (with the data of its continuations), to
+// the events array when dumping as JSON or as a line of text to fp
+static void udiald_trace_emit(FILE *fp, struct json_object *events, const struct udiald_trace_entry *e, const char *data, size_t len) {
+	if (events)
+		udiald_trace_add_json(events, e, data, len);
+	else
+		udiald_trace_write_text(fp, e, data, len);
+}
+
+/**
+ * Write all events still in the ring to the file set with
+ * udiald_trace_init, oldest first. Returns 0 on success or -1 on error
+ * (including when no file was set).
+ */
+int udiald_trace_dump(void) {
+	if (!trace_path[0])
+		return -1;
+
+	FILE *fp = fopen(trace_path, "w");
+	if (!fp) {
+		udiald_log(LOG_ERR, "Failed to write trace to %s: %s", trace_path, strerror(errno));
+		return -1;
+	}
+
+	struct json_object *events = trace_json ? json_object_new_array() : NULL;
+	uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+	uint32_t idx = head > UDIALD_TRACE_EVENTS ? head - UDIALD_TRACE_EVENTS : 0;
+	struct udiald_trace_entry e, next;
+	bool have = false;
+	uint32_t expect = 0;	/* Index a continuation of e would have */
+	char data[UDIALD_TRACE_MAXLEN];
+	size_t len = 0;
+	size_t count = 0;
+
+	for (; idx != head; ++idx) {
+		if (!udiald_trace_copy(idx, &next))
+			continue;
+		if (next.flags & UDIALD_TRACE_CONT) {
+			// Only append to the event it belongs to, the
+			// start might have been overwritten already
+			if (have && idx == expect && len + next.len <= sizeof(data)) {
+				memcpy(data + len, next.data, next.len);
+				len += next.len;
+				e.flags |= next.flags & UDIALD_TRACE_TRUNCATED;
+				expect++;
+			}
+			continue;
+		}
+
+		if (have) {
+			udiald_trace_emit(fp, events, &e, data, len);
+			count++;
+		}
+		e = next;
+		memcpy(data, e.data, e.len);
+		len = e.len;
+		have = true;
+		expect = idx + 1;
+	}
+	if (have) {
+		udiald_trace_emit(fp, events, &e, data, len);
+		count++;
+	}
+
+	if (events) {
+		fprintf(fp, "%s\n", json_object_to_json_string_ext(events, JSON_C_TO_STRING_PRETTY));
+		json_object_put(events);
+	}
+	fclose(fp);
+	udiald_log(LOG_NOTICE, "Wrote %zu trace events to %s", count, trace_path);
+	return 0;
+}
@@ -0,0 +1,193 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Binary transcript of all data exchanged with the modem.
+ *
+ * A transcript starts with the 8 byte header "UDTR" 0x01 0x00 0x00 0x00
+ * (the fifth byte is the format version), followed by records. Each
+ * record is a 12 byte header followed by the data:
+ *
+ *   8 bytes  CLOCK_MONOTONIC timestamp in ms, little endian
+ *   1 byte   channel (enum udiald_transcript_channel)
+ *   1 byte   direction (enum udiald_transcript_dir)
+ *   2 bytes  length of the data, little endian
+ *
+ * The control process and the dialer (started by pppd) append to the
+ * same file, which is why every record is written with a single
+ * writev() call on an O_APPEND fd.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <syslog.h>
+#include <sys/uio.h>
+#include "udiald.h"
+
+#define UDIALD_TRANSCRIPT_MAGIC "UDTR\x01\0\0"
+#define UDIALD_TRANSCRIPT_HEADER_LEN 12
+
+static int transcript_fd = -1;
+static enum udiald_transcript_channel transcript_channel;
+
+/**
+ * Start recording everything sent to and received from the modem to
+ * the given file. Returns UDIALD_OK or UDIALD_EINTERNAL.
+ */
+int udiald_transcript_open(const char *path, enum udiald_transcript_channel channel) {
+	int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		udiald_log(LOG_ERR, "Failed to open transcript %s: %s", path, strerror(errno));
+		return UDIALD_EINTERNAL;
+	}
+
+	// A new file gets the header, an existing one is appended to
+	// (the dialer appends to the transcript of the control process)
+	if (lseek(fd, 0, SEEK_END) == 0
+	&& write(fd, UDIALD_TRANSCRIPT_MAGIC, 8) != 8) {
+		udiald_log(LOG_ERR, "Failed to write transcript %s: %s", path, strerror(errno));
+		close(fd);
+		return UDIALD_EINTERNAL;
+	}
+
+	transcript_fd = fd;
+	transcript_channel = channel;
+	return UDIALD_OK;
+}
+
+void udiald_transcript_close(void) {
+	if (transcript_fd >= 0)
+		close(transcript_fd);
+	transcript_fd = -1;
+}
+
+/**
+ * Record data sent or received, given as an array of buffers. Does
+ * nothing when no transcript is open.
+ */
+void udiald_transcript_recordv(enum udiald_transcript_dir dir, const struct iovec *data, int count) {
+	if (transcript_fd < 0)
+		return;
+
+	size_t len = 0;
+	for (int i = 0; i < count; ++i)
+		len += data[i].iov_len;
+	// Longer data (unlikely for a single read or command) is cut off
+	if (len > UINT16_MAX)
+		len = UINT16_MAX;
+
+	uint8_t header[UDIALD_TRANSCRIPT_HEADER_LEN];
+	uint64_t now = udiald_util_now_ms();
+	for (int i = 0; i < 8; ++i)
+		header[i] = now >> (8 * i);
+	header[8] = transcript_channel;
+	header[9] = dir;
+	header[10] = len & 0xff;
+	header[11] = len >> 8;
+
+	struct iovec iov[count + 1];
+	iov[0].iov_base = header;
+	iov[0].iov_len = sizeof(header);
+	size_t left = len;
+	for (int i = 0; i < count; ++i) {
+		iov[i + 1] = data[i];
+		if (iov[i + 1].iov_len > left)
+			iov[i + 1].iov_len = left;
+		left -= iov[i + 1].iov_len;
+	}
+
+	// Commands are written from a masked copy, so transcripts can be
+	// passed around without giving away the PIN
+	static char copy[UINT16_MAX];
+	if (dir == UDIALD_TRANSCRIPT_TX) {
+		size_t off = 0;
+		for (int i = 1; i <= count; ++i) {
+			memcpy(copy + off, iov[i].iov_base, iov[i].iov_len);
+			off += iov[i].iov_len;
+		}
+		udiald_util_redact(copy, len);
+		iov[1].iov_base = copy;
+		iov[1].iov_len = len;
+		count = 1;
+	}
+
+	// Errors are ignored, a transcript is a debugging aid only
+	if (writev(transcript_fd, iov, count + 1) < 0)
+		udiald_log(LOG_DEBUG, "Failed to write transcript: %s", strerror(errno));
+}
+
+void udiald_transcript_record(enum udiald_transcript_dir dir, const void *data, size_t len) {
+	struct iovec iov = {.iov_base = (void *)data, .iov_len = len};
+	udiald_transcript_recordv(dir, &iov, 1);
+}
+
+// read() that keeps going until len bytes were read. Returns the
+// number of bytes read (less than len only at end of file) or -1.
+static ssize_t udiald_transcript_read_full(int fd, void *buf, size_t len) {
+	size_t done = 0;
+	while (done < len) {
+		ssize_t n = read(fd, (char *)buf + done, len - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return -1;
+		if (n == 0)
+			break;
+		done += n;
+	}
+	return done;
+}
+
+/**
+ * Check the header of a transcript opened for reading.
+ * Returns UDIALD_OK or UDIALD_EINVAL.
+ */
+int udiald_transcript_read_header(int fd) {
+	char magic[8];
+	if (udiald_transcript_read_full(fd, magic, sizeof(magic)) != sizeof(magic)
+	|| memcmp(magic, UDIALD_TRANSCRIPT_MAGIC, sizeof(magic)))
+		return UDIALD_EINVAL;
+	return UDIALD_OK;
+}
+
+/**
+ * Read the next record from a transcript into rec. The data is stored
+ * in rec->data, which can hold any record. Returns 1 when a record was
+ * read, 0 at the end of the transcript or -1 when it is truncated.
+ */
+int udiald_transcript_read(int fd, struct udiald_transcript_record *rec) {
+	uint8_t header[UDIALD_TRANSCRIPT_HEADER_LEN];
+	ssize_t n = udiald_transcript_read_full(fd, header, sizeof(header));
+	if (n == 0)
+		return 0;
+	if (n != sizeof(header))
+		return -1;
+
+	rec->timestamp = 0;
+	for (int i = 0; i < 8; ++i)
+		rec->timestamp |= (uint64_t)header[i] << (8 * i);
+	rec->channel = header[8];
+	rec->dir = header[9];
+	rec->len = header[10] | header[11] << 8;
+
+	if (udiald_transcript_read_full(fd, rec->data, rec->len) != rec->len)
+		return -1;
+	return 1;
+}
@@ -23,9 +23,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <poll.h>
@@ -34,18 +38,52 @@
 #include "udiald.h"
 #include "config.h"
 
-static const char *ttyresstr[] = {
-	[UDIALD_AT_OK] = "OK",
-	[UDIALD_AT_CONNECT] = "CONNECT",
-	[UDIALD_AT_ERROR] = "ERROR",
-	[UDIALD_AT_CMEERROR] = "+CME ERROR",
-	[UDIALD_AT_NODIALTONE] = "NO DIALTONE",
-	[UDIALD_AT_BUSY] = "BUSY",
-	[UDIALD_AT_NOCARRIER] = "NO CARRIER",
-	// This one seems to be Huawei-specific:
-	[UDIALD_AT_NOT_SUPPORTED] = "COMMAND NOT SUPPORT",
+// Generated from data/gen-atres.py, defines udiald_atres_match
+#include "atres_table.h"
+
+// Initial size of the receive buffer kept for each tty. It grows when
+// needed, up to max_response bytes.
+#define UDIALD_TTY_BUFSIZE 1024
+// Initial number of lines in a response we keep room for
+#define UDIALD_TTY_LINES 16
+
+// Receive buffer for a single tty. Data is read from the tty in chunks
+// as large as possible, and any bytes received after a final result
+// code are kept here for the next call to udiald_tty_get.
+//
+// Lines are nul-terminated in place and responses point directly into
+// this buffer. The data of a response is kept in the buffer until the
+// next response is started.
+struct udiald_tty_buf {
+	bool used;
+	int fd;
+	char *data;
+	size_t size;
+	// Offset of the start of the current response
+	size_t resp;
+	// Offset of the first byte not processed yet
+	size_t start;
+	// Offset after the last byte received
+	size_t end;
+	// Lines of the current response, pointing into data
+	char **lines;
+	size_t lines_size;
+	size_t nlines;
 };
 
+// Maximum size of the receive buffer, which limits the size of a
+// single response.
+static size_t max_response = UDIALD_TTY_MAX_RESPONSE;
+
+// We only ever use a control tty, and a data tty when dialing (which
+// might have different fds for reading and writing).
+static struct udiald_tty_buf ttybufs[4];
+
+// Registered handlers for unsolicited result codes
+static LIST_HEAD(urcs);
+
+static struct udiald_tty_stats tty_stats;
+
 int udiald_tty_open(const char *tty) {
 	struct termios tio;
 	int fd = open(tty, O_RDWR | O_NOCTTY | O_NONBLOCK);
@@ -63,140 +101,852 @@ int udiald_tty_open(const char *tty) {
 	tio.c_cc[VTIME]=0;
 	tcsetattr(fd, TCSANOW, &tio);
 
+	// Make sure no stale data from a previous use of this fd number
+	// is left in our receive buffer.
+	udiald_tty_flush(fd);
+
 	return fd;
 }
 
 // "Flatten" a udiald_tty_result, so it becomes a single string that can
 // be stored in uci or logged.
 //
-// The resulting pointer points to a buffer insided the passed
-// udiald_tty_read so it does not need to be freed and is valid until
-// the next call to this function with the same udiald_tty_read.
+// The resulting pointer points to a buffer inside this module, so it
+// does not need to be freed and is valid until the next call to this
+// function. The string is only built when this is called, so only call
+// it when the result is actually used.
 const char *udiald_tty_flatten_result(struct udiald_tty_read *r) {
-	char *flat = r->flat_buf;
-	char *end = flat + lengthof(r->flat_buf) - 1;
+	static char *flat;
+	static size_t flat_size;
+
+	// Each line gets quotes and a separator added
+	size_t len = 1;
+	for (size_t i = 0; i < r->lines; ++i)
+		len += strlen(r->raw_lines[i]) + 4;
+
+	if (len > flat_size) {
+		char *n = realloc(flat, len);
+		if (!n)
+			return "";
+		flat = n;
+		flat_size = len;
+	}
 
+	char *out = flat;
 	for (size_t i = 0; i < r->lines; ++i) {
-		char *in = r->raw_lines[i];
-		if (flat != end) *flat++ = '"';
-		while (*in)
-			if (flat != end) *flat++ = *in++;
-		if (flat != end) *flat++ = '"';
+		size_t l = strlen(r->raw_lines[i]);
+		*out++ = '"';
+		memcpy(out, r->raw_lines[i], l);
+		out += l;
+		*out++ = '"';
 		if (i != r->lines - 1) {
-			if (flat != end) *flat++ = ',';
-			if (flat != end) *flat++ = ' ';
+			*out++ = ',';
+			*out++ = ' ';
+		}
+	}
+	*out = '\0';
+	return flat;
+}
+
+// Set the maximum number of bytes a single response (including any
+// unsolicited lines received in between) can take up.
+void udiald_tty_set_max_response(size_t max) {
+	if (max < UDIALD_TTY_BUFSIZE)
+		max = UDIALD_TTY_BUFSIZE;
+	max_response = max;
+}
+
+// Write all of the given buffers to fd, using as few write calls as
+// possible. Partial writes are continued and when the fd is not
+// writable, we wait for it for at most UDIALD_TTY_WRITE_TIMEOUT ms.
+// Returns the number of bytes written or -1 on error.
+ssize_t udiald_tty_putv(int fd, struct iovec *iov, int iovcnt) {
+	size_t total = 0;
+	for (int i = 0; i < iovcnt; ++i)
+		total += iov[i].iov_len;
+
+	if (verbose >= 2) {
+		char b[512];
+		size_t len = 0;
+		for (int i = 0; i < iovcnt && len < sizeof(b) - 1; ++i)
+			len += snprintf(b + len, sizeof(b) - len, "%.*s", (int)iov[i].iov_len, (char *)iov[i].iov_base);
+		udiald_log(LOG_DEBUG, "Writing: %s", b);
+	}
+
+	udiald_transcript_recordv(UDIALD_TRANSCRIPT_TX, iov, iovcnt);
+	udiald_tracev(UDIALD_TRACE_TX, fd, 0, iov, iovcnt);
+	// Keep the command for statistics, iov is modified below
+	struct iovec iov_orig[iovcnt];
+	int iovcnt_orig = iovcnt;
+	memcpy(iov_orig, iov, sizeof(iov_orig));
+
+	int64_t deadline = udiald_util_now_ms() + UDIALD_TTY_WRITE_TIMEOUT;
+	size_t left = total;
+	while (left) {
+		ssize_t written = writev(fd, iov, iovcnt);
+		tty_stats.writes++;
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				udiald_log(LOG_ERR, "Write failed: %s", strerror(errno));
+				return -1;
+			}
+			// Wait for room in the output buffer
+			struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+			int64_t remaining = deadline - udiald_util_now_ms();
+			if (remaining <= 0 || udiald_clock_poll(&pfd, 1, remaining) <= 0) {
+				udiald_log(LOG_ERR, "Write timed out");
+				errno = ETIMEDOUT;
+				return -1;
+			}
+			continue;
+		}
+		tty_stats.bytes_written += written;
+		left -= written;
+
+		// Skip the buffers that were written completely
+		while (iovcnt && (size_t)written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt) {
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= written;
 		}
-		if (flat == end)
-			break;
 	}
-	*flat = '\0';
-	return r->flat_buf;
+	udiald_cmdstats_sent(iov_orig, iovcnt_orig);
+	return total;
 }
 
 int udiald_tty_put(int fd, const char *cmd) {
-	if (verbose >= 2)
-		syslog(LOG_DEBUG, "Writing: %s", cmd);
-	if (write(fd, cmd, strlen(cmd)) != strlen(cmd))
-		return -1;
-	return strlen(cmd);
+	struct iovec iov = {.iov_base = (char *)cmd, .iov_len = strlen(cmd)};
+	return udiald_tty_putv(fd, &iov, 1);
 }
 
-// Retrieve answer from modem
-enum udiald_atres udiald_tty_get(int fd, struct udiald_tty_read *r, const char *result_prefix, int timeout) {
-	struct pollfd pfd = {.fd = fd, .events = POLLIN | POLLERR | POLLHUP};
+// Counters for the data sent and received on all ttys
+const struct udiald_tty_stats *udiald_tty_get_stats(void) {
+	return &tty_stats;
+}
+
+// Look up the receive buffer for the given fd, claiming a free one if
+// this fd does not have one yet. Returns NULL (with errno set) when all
+// buffers are in use.
+static struct udiald_tty_buf *udiald_tty_getbuf(int fd) {
+	struct udiald_tty_buf *free_buf = NULL;
+	for (size_t i = 0; i < lengthof(ttybufs); ++i) {
+		if (ttybufs[i].used && ttybufs[i].fd == fd)
+			return &ttybufs[i];
+		if (!ttybufs[i].used && !free_buf)
+			free_buf = &ttybufs[i];
+	}
+
+	if (!free_buf) {
+		udiald_log(LOG_ERR, "No receive buffer available for fd %d", fd);
+		errno = EMFILE;
+		return NULL;
+	}
+
+	if (!free_buf->data) {
+		free_buf->data = malloc(UDIALD_TTY_BUFSIZE);
+		free_buf->lines = malloc(UDIALD_TTY_LINES * sizeof(*free_buf->lines));
+		if (!free_buf->data || !free_buf->lines) {
+			free(free_buf->data);
+			free(free_buf->lines);
+			free_buf->data = NULL;
+			free_buf->lines = NULL;
+			udiald_log(LOG_ERR, "Failed to allocate receive buffer for fd %d", fd);
+			errno = ENOMEM;
+			return NULL;
+		}
+		free_buf->size = UDIALD_TTY_BUFSIZE;
+		free_buf->lines_size = UDIALD_TTY_LINES;
+	}
+
+	free_buf->used = true;
+	free_buf->fd = fd;
+	free_buf->resp = free_buf->start = free_buf->end = 0;
+	free_buf->nlines = 0;
+	return free_buf;
+}
+
+// Discard any pending input, both in the kernel and in our own receive
+// buffer.
+void udiald_tty_flush(int fd) {
+	struct udiald_tty_buf *b = udiald_tty_getbuf(fd);
+	if (b) {
+		b->resp = b->start = b->end = 0;
+		b->nlines = 0;
+	}
+	tcflush(fd, TCIFLUSH);
+}
+
+/**
+ * Register a handler for unsolicited result codes (URCs) starting with
+ * urc->prefix. The handler is called for matching lines received on any
+ * tty, both while a command is running and while the tty is idle.
+ */
+void udiald_tty_urc_register(struct udiald_urc *urc) {
+	list_add_tail(&urc->h, &urcs);
+}
+
+void udiald_tty_urc_unregister(struct udiald_urc *urc) {
+	list_del(&urc->h);
+}
+
+// See if the given line is an unsolicited result code and if so, pass
+// it to the registered handler. Lines starting with the prefix of the
+// response we are waiting for are never considered unsolicited.
+// Returns true when the line was handled as an unsolicited result.
+static bool udiald_tty_urc_dispatch(const char *line, const char *result_prefix) {
+	if (result_prefix && !strncmp(line, result_prefix, strlen(result_prefix)))
+		return false;
+
+	struct udiald_urc *urc;
+	list_for_each_entry(urc, &urcs, h) {
+		if (!strncmp(line, urc->prefix, strlen(urc->prefix))) {
+			urc->cb(urc, line);
+			return true;
+		}
+	}
 
-	int err;
-	char *c = r->raw_buf;
-	size_t rem = lengthof(r->raw_buf);
+	// Lines starting with ^ are always unsolicited (Huawei uses
+	// these for all kinds of status reports), so drop them even
+	// when nobody is interested.
+	if (line[0] == '^') {
+		udiald_log(LOG_DEBUG, "Ignoring unsolicited line: %s", line);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Find out if the given line (len bytes, excluding the nul terminator)
+ * is a final result code. Returns the result code, or UDIALD_FAIL for
+ * any other line.
+ *
+ * For +CME ERROR and +CMS ERROR, the error number is stored in *error
+ * (-1 when the modem does not report a numeric error, e.g. after
+ * AT+CMEE=2). *error is left alone otherwise.
+ */
+enum udiald_atres udiald_tty_classify(const char *line, size_t len, int *error) {
+	enum udiald_atres res = udiald_atres_match(line, len);
+
+	if (res == UDIALD_AT_CMEERROR || res == UDIALD_AT_CMSERROR) {
+		// +CME ERROR: <err>
+		const char *num = line + strlen("+CME ERROR");
+		while (*num == ':' || *num == ' ')
+			num++;
+		char *end;
+		long n = strtol(num, &end, 10);
+		*error = (end != num && !*end) ? n : -1;
+	}
+	return res;
+}
+
+// Cut the next complete line from the receive buffer. The line is
+// nul-terminated in place and returned, its length is stored in *len.
+// Returns NULL when there is no complete line in the buffer.
+static char *udiald_tty_next_line(struct udiald_tty_buf *b, size_t *len) {
+	char *start = b->data + b->start;
+	size_t avail = b->end - b->start;
+
+	// Lines can be terminated by \r, \n or both, find whichever
+	// comes first.
+	char *eol = memchr(start, '\r', avail);
+	char *nl = memchr(start, '\n', eol ? (size_t)(eol - start) : avail);
+	if (nl)
+		eol = nl;
+	if (!eol)
+		return NULL;
+
+	*eol = '\0';
+	*len = eol - start;
+	b->start += *len + 1;
+	return start;
+}
+
+// Prepare a udiald_tty_read for collecting a new response
+void udiald_tty_read_init(struct udiald_tty_read *r) {
 	r->lines = 0;
+	r->raw_lines = NULL;
 	r->result_line = NULL;
-	bool in_newline = true;
+	r->remaining = 0;
+	r->cme_error = -1;
+}
+
+// Process the complete lines currently in the receive buffer for fd,
+// adding them to the response in r. Returns the final result code once
+// a known AT status code is found. Returns -1 with errno set to EAGAIN
+// when more data is needed, or to another error code when something
+// went wrong.
+//
+// The lines in r point into the receive buffer, so they are only valid
+// until the next response is started on the same fd.
+enum udiald_atres udiald_tty_parse(int fd, struct udiald_tty_read *r, const char *result_prefix) {
+	struct udiald_tty_buf *b = udiald_tty_getbuf(fd);
+	if (!b)
+		return -1;
+
+	if (!r->lines) {
+		// Start of a new response, earlier responses are no
+		// longer needed
+		b->resp = b->start;
+		b->nlines = 0;
+	} else if (r->lines != b->nlines) {
+		// The response did not fit in the buffer and was
+		// discarded
+		r->lines = 0;
+		errno = ERANGE;
+		return -1;
+	}
+
+	char *line;
+	size_t len;
+	while ((line = udiald_tty_next_line(b, &len))) {
+		// Skip empty lines (e.g. the \n in \r\n)
+		if (!len)
+			continue;
+
+		udiald_log(LOG_DEBUG, "Read: %s", line);
+
+		// Async reply, pretend the line was never there
+		if (udiald_tty_urc_dispatch(line, result_prefix))
+			continue;
+
+		if (b->nlines == b->lines_size) {
+			char **n = realloc(b->lines, 2 * b->lines_size * sizeof(*b->lines));
+			if (!n) {
+				udiald_log(LOG_ERR, "Failed to allocate room for %zu lines", 2 * b->lines_size);
+				errno = ENOMEM;
+				return -1;
+			}
+			b->lines = n;
+			b->lines_size *= 2;
+		}
+
+		// Add the line to the result
+		b->lines[b->nlines++] = line;
+		r->raw_lines = b->lines;
+		r->lines = b->nlines;
+
+		// Compare with known AT status codes
+		enum udiald_atres res = udiald_tty_classify(line, len, &r->cme_error);
+		if (res != UDIALD_FAIL) {
+			// Find the first line starting with the given
+			// prefix. This is only done now, since earlier
+			// lines move when the buffer is compacted or
+			// grown while waiting for more data.
+			for (size_t i = 0; result_prefix && i < b->nlines; ++i) {
+				if (!strncmp(b->lines[i], result_prefix, strlen(result_prefix))) {
+					r->result_line = b->lines[i];
+					break;
+				}
+			}
+			return res;
+		}
+	}
+
+	errno = EAGAIN;
+	return -1;
+}
+
+// Process any complete lines in the receive buffer for fd while no
+// command is running. These can only be unsolicited messages from the
+// modem, which are passed to their handlers (or logged and dropped).
+void udiald_tty_drain(int fd) {
+	struct udiald_tty_buf *b = udiald_tty_getbuf(fd);
+	if (!b)
+		return;
+
+	// No response is being collected
+	b->nlines = 0;
+
+	char *line;
+	size_t len;
+	while ((line = udiald_tty_next_line(b, &len))) {
+		if (!len)
+			continue;
+		udiald_log(LOG_DEBUG, "Read: %s", line);
+		if (!udiald_tty_urc_dispatch(line, NULL))
+			udiald_log(LOG_DEBUG, "Ignoring unsolicited line: %s", line);
+	}
+}
+
+// Move the data in the receive buffer so it starts at offset from,
+// and update the pointers into it.
+static void udiald_tty_rebase(struct udiald_tty_buf *b, char *data, size_t from) {
+	for (size_t i = 0; i < b->nlines; ++i)
+		b->lines[i] = data + (b->lines[i] - b->data) - from;
+	b->data = data;
+	b->resp -= from;
+	b->start -= from;
+	b->end -= from;
+}
+
+// Make room in the receive buffer, by dropping data that is no longer
+// needed and growing the buffer if that is not enough. Returns -1
+// (with errno set to ERANGE) when the buffer cannot grow any further.
+static int udiald_tty_make_room(struct udiald_tty_buf *b) {
+	// Keep the current response and any partial line
+	size_t keep = b->nlines ? b->resp : b->start;
+	if (keep) {
+		memmove(b->data, b->data + keep, b->end - keep);
+		udiald_tty_rebase(b, b->data, keep);
+	}
+
+	if (b->end < b->size)
+		return 0;
+
+	if (b->size >= max_response) {
+		udiald_log(LOG_ERR, "No complete response received within %zu bytes", b->size);
+		b->resp = b->start = b->end = 0;
+		b->nlines = 0;
+		errno = ERANGE;
+		return -1;
+	}
+
+	size_t size = 2 * b->size;
+	if (size > max_response)
+		size = max_response;
+	char *data = realloc(b->data, size);
+	if (!data) {
+		udiald_log(LOG_ERR, "Failed to grow receive buffer to %zu bytes", size);
+		errno = ENOMEM;
+		return -1;
+	}
+	udiald_tty_rebase(b, data, 0);
+	b->size = size;
+	return 0;
+}
+
+// Read whatever data is available from fd into its receive buffer,
+// using a single read() call. Returns the number of bytes read, 0 when
+// no data was available (with errno set to EAGAIN) or at end of file
+// (with errno set to 0), or -1 on error.
+ssize_t udiald_tty_fill(int fd) {
+	struct udiald_tty_buf *b = udiald_tty_getbuf(fd);
+	if (!b)
+		return -1;
+
+	if (udiald_tty_make_room(b) < 0)
+		return -1;
+
+	ssize_t rxed = read(fd, b->data + b->end, b->size - b->end);
+	tty_stats.reads++;
+	if (rxed == -1) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;
+		udiald_log(LOG_ERR, "Read failed: %s", strerror(errno));
+		return -1;
+	}
+	if (rxed == 0) {
+		errno = 0;
+		return 0;
+	}
+	udiald_transcript_record(UDIALD_TRANSCRIPT_RX, b->data + b->end, rxed);
+	udiald_trace(UDIALD_TRACE_RX, fd, 0, b->data + b->end, rxed);
+	b->end += rxed;
+	tty_stats.bytes_read += rxed;
+	return rxed;
+}
+
+// Retrieve answer from modem, waiting at most timeout milliseconds in
+// total. The timeout is shortened when the command sent last is known
+// to be answered faster (see cmdstats.c).
+enum udiald_atres udiald_tty_get(int fd, struct udiald_tty_read *r, const char *result_prefix, int timeout) {
+	timeout = udiald_cmdstats_timeout(timeout);
+	return udiald_tty_get_until(fd, r, result_prefix, udiald_util_now_ms() + timeout);
+}
+
+static enum udiald_atres udiald_tty_wait(int fd, struct udiald_tty_read *r, const char *result_prefix, int64_t deadline) {
+	struct pollfd pfd = {.fd = fd, .events = POLLIN | POLLERR | POLLHUP};
+	udiald_tty_read_init(r);
 
 	// Modems are evil, they might not send the complete answer when doing
-	// a read, so we read until we get a known AT status code (see top)
-	while (rem > 0) {
-		err = poll(&pfd, 1, timeout);
+	// a read, so we read until we get a known AT status code
+	while (true) {
+		// First process any complete lines still in the buffer
+		// (possibly left over from a previous call).
+		enum udiald_atres res = udiald_tty_parse(fd, r, result_prefix);
+		int64_t remaining = deadline - udiald_util_now_ms();
+		r->remaining = remaining > 0 ? remaining : 0;
+		if (res != UDIALD_FAIL || errno != EAGAIN)
+			return res;
+
+		int err = r->remaining ? udiald_clock_poll(&pfd, 1, r->remaining) : 0;
 		if (err == 0) {
-			syslog(LOG_ERR, "Poll timed out");
+			udiald_log(LOG_ERR, "Poll timed out");
 			errno = ETIMEDOUT;
 			return -1;
 		}
+		// A dump was requested (SIGUSR1), keep waiting
+		if (err < 0 && errno == EINTR && udiald_util_dump_check())
+			continue;
 		if (err < 0) {
-			syslog(LOG_ERR, "Poll failed: %s", strerror(errno));
+			udiald_log(LOG_ERR, "Poll failed: %s", strerror(errno));
 			return -1;
 		}
 
-		ssize_t rxed;
-		while ((rxed = read(fd, c, 1)) > 0) {
-			if (c[0] == '\r' || c[0] == '\n') {
-				if (!in_newline) {
-					// Found the end of the current line,
-					// process it.
-					in_newline = true;
-					// Replace the newline with a
-					// nul-termination
-					c[0] = '\0';
-
-					char *start = r->raw_lines[r->lines];
-
-					syslog(LOG_DEBUG, "Read: %s", start);
-
-					if (start[0] == '^') {
-						// Async reply, pretend the line was
-						// never there
-						c = start;
-						continue;
-					}
-
-					++r->lines;
-
-					// See if the current line starts with the
-					// given prefix
-					if (!r->result_line && result_prefix && !strncmp(start, result_prefix, strlen(result_prefix)))
-					    r->result_line = start;
-
-					// Compare with known AT status codes (array at the very top)
-					for (size_t i = 0; i < lengthof(ttyresstr); ++i)
-						if (!strncmp(start, ttyresstr[i], strlen(ttyresstr[i])))
-							return i;
-
-			    } else {
-				    // Continuing the current newline, don't
-				    // include this character in the output.
-				    rxed = 0;
-			    }
-			} else if (in_newline) {
-				// We were in a newline, but now found a
-				// non-newline character. Start a new line.
-
-				if (r->lines == lengthof(r->raw_lines) - 1) {
-					syslog(LOG_ERR, "No complete response received within %zu lines", lengthof(r->raw_lines));
-					errno = ERANGE;
-					return -1;
-				}
+		// Read as much as is available in one go
+		ssize_t rxed = udiald_tty_fill(fd);
+		if (rxed < 0) {
+			if (errno == ERANGE)
+				r->lines = 0;
+			return -1;
+		}
+		if (rxed == 0 && pfd.revents & (POLLERR | POLLHUP)) {
+			udiald_log(LOG_ERR, "Terminal hung up");
+			errno = EPIPE;
+			return -1;
+		}
+	}
+}
+
+// Retrieve answer from modem, giving up when the CLOCK_MONOTONIC
+// deadline (as returned by udiald_util_now_ms) passes. Stray bytes
+// received do not extend the deadline. The time left until the
+// deadline is stored in r->remaining.
+enum udiald_atres udiald_tty_get_until(int fd, struct udiald_tty_read *r, const char *result_prefix, int64_t deadline) {
+	enum udiald_atres res = udiald_tty_wait(fd, r, result_prefix, deadline);
+	int err = errno;
+	udiald_cmdstats_done(res, err);
+	errno = err;
+	return res;
+}
 
-				// Remember the start of the line
-				r->raw_lines[r->lines] = c;
+// Query packet switched registration with cmd (e.g. "AT+CGREG?\r") and
+// return the registration status, or -1 when the modem did not answer
+// with one. Sets *unsupported when the modem rejects the command.
+static int udiald_tty_dial_regstat(int in, int out, const char *cmd, const char *prefix, bool *unsupported) {
+	struct udiald_tty_read r;
+	struct udiald_creg reg;
+	udiald_tty_put(out, cmd);
+	enum udiald_atres res = udiald_tty_get(in, &r, prefix, 2500);
+	if (res == UDIALD_AT_ERROR || res == UDIALD_AT_CMEERROR)
+		*unsupported = true;
+	if (res != UDIALD_AT_OK || udiald_parse_creg(r.result_line, false, &reg))
+		return -1;
+	return reg.stat;
+}
 
-				in_newline = false;
-			} else {
-				// Regular character, halfway a line. Do
-				// nothing special.
-			}
+// Query the packet switched registration (+CGREG for GPRS / UMTS,
+// +CEREG for LTE) and store it in dial->regstat. Returns whether the
+// modem is registered to its home network or roaming. The status of
+// each command is stored in stat and estat (-1 when not known).
+static bool udiald_tty_dial_registered(int in, int out, struct udiald_tty_dial *dial, int *stat, int *estat) {
+	*stat = *estat = -1;
+	if (!dial->no_cgreg)
+		*stat = udiald_tty_dial_regstat(in, out, "AT+CGREG?\r", "+CGREG: ", &dial->no_cgreg);
+	if (*stat == UDIALD_REG_HOME || *stat == UDIALD_REG_ROAMING) {
+		dial->regstat = *stat;
+		return true;
+	}
+	// Only ask about LTE when not registered otherwise
+	if (!dial->no_cereg)
+		*estat = udiald_tty_dial_regstat(in, out, "AT+CEREG?\r", "+CEREG: ", &dial->no_cereg);
+	dial->regstat = *estat >= 0 ? *estat : *stat;
+	return *estat == UDIALD_REG_HOME || *estat == UDIALD_REG_ROAMING;
+}
+
+// Poll the packet switched registration every dial->reg_poll ms until
+// the modem is registered. Returns UDIALD_AT_OK once registered, or -1
+// with errno set to EACCES when registration was denied or to ETIMEDOUT
+// when dial->deadline passed first. When the modem supports neither
+// command, dial->reg_poll is cleared and UDIALD_AT_OK returned, so the
+// caller dials blindly.
+static enum udiald_atres udiald_tty_dial_wait(int in, int out, struct udiald_tty_dial *dial) {
+	int64_t start = udiald_util_now_ms(), now;
+	bool logged = false;
+	int stat, estat;
 
-			rem -= rxed;
-			c += rxed;
+	while (true) {
+		bool registered = udiald_tty_dial_registered(in, out, dial, &stat, &estat);
+		now = udiald_util_now_ms();
+		if (dial->no_cgreg && dial->no_cereg) {
+			udiald_log(LOG_NOTICE, "%s: Registration status not available, dialing anyway", dial->name);
+			dial->reg_poll = 0;
+			break;
+		}
+		if (registered) {
+			if (logged)
+				udiald_log(LOG_NOTICE, "%s: Registered (%s) after %lld ms", dial->name,
+					udiald_regstatus_str(dial->regstat), (long long)(now - start));
+			break;
+		}
+		// Packet service is refused on every network the modem
+		// can tell about
+		if ((stat == UDIALD_REG_DENIED || dial->no_cgreg)
+		&& (estat == UDIALD_REG_DENIED || dial->no_cereg)) {
+			dial->wait += now - start;
+			udiald_log(LOG_ERR, "%s: Packet service registration denied", dial->name);
+			errno = EACCES;
+			return -1;
+		}
+		if (now + dial->reg_poll >= dial->deadline) {
+			dial->wait += now - start;
+			udiald_log(LOG_ERR, "%s: Not registered (%s) and dial timeout reached", dial->name,
+				udiald_regstatus_str(dial->regstat));
+			errno = ETIMEDOUT;
+			return -1;
 		}
-		if (rxed == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
-			syslog(LOG_ERR, "Read failed: %s", strerror(errno));
+		if (!logged) {
+			udiald_log(LOG_NOTICE, "%s: Waiting for packet service registration (%s)", dial->name,
+				udiald_regstatus_str(dial->regstat));
+			logged = true;
+		}
+		udiald_clock_sleep_ms(dial->reg_poll);
+	}
+	dial->wait += now - start;
+	return UDIALD_AT_OK;
+}
+
+// Send the dial command to out and wait for the response on in.
+//
+// With dial->reg_poll set, the packet switched registration is polled
+// first and the dial command only sent once the modem is registered.
+// When the modem answers NO CARRIER after all, the registration is
+// checked again: if it was lost meanwhile, wait for it and dial again.
+// If the modem is still registered, the network rejected the context
+// (e.g. a wrong APN), which is retried at most dial->retries times
+// after dial->retry_delay ms. Other failures (ERROR, BUSY, ...) are not
+// retried, as they will not go away by themselves.
+//
+// Without reg_poll (or when the modem cannot report its registration),
+// NO CARRIER is taken to mean that the modem is not registered yet, so
+// dialing is retried every dial->retry_delay ms.
+//
+// All attempts and the waits in between share a single time budget, up
+// to dial->deadline.
+enum udiald_atres udiald_tty_dial(int in, int out, struct udiald_tty_dial *dial, struct udiald_tty_read *r) {
+	enum udiald_atres res;
+	unsigned rejected = 0;
+	dial->regstat = -1;
+	while (true) {
+		if (dial->reg_poll && udiald_tty_dial_wait(in, out, dial) != UDIALD_AT_OK) {
+			udiald_tty_read_init(r);
 			return -1;
 		}
 
+		udiald_log(LOG_INFO, "%s: Using dial command: %s", dial->name, dial->dialcmd);
+		udiald_tty_put(out, dial->dialcmd);
+		dial->attempts++;
+		if (dial->attempt)
+			dial->attempt(dial);
+		res = udiald_tty_get_until(in, r, NULL, dial->deadline);
+		if (res != UDIALD_AT_NOCARRIER && res != UDIALD_AT_OK)
+			return res;
+		if (r->remaining < dial->retry_delay) {
+			udiald_log(LOG_NOTICE, "%s: No carrier and dial timeout reached", dial->name);
+			return res;
+		}
+
+		if (!dial->reg_poll) {
+			udiald_log(LOG_NOTICE, "%s: No carrier. Waiting for network...", dial->name);
+			udiald_clock_sleep_ms(dial->retry_delay);
+			continue;
+		}
+
+		// Still registered? Then only retry a limited number of times
+		int stat, estat;
+		if (!udiald_tty_dial_registered(in, out, dial, &stat, &estat)) {
+			udiald_log(LOG_NOTICE, "%s: No carrier, registration lost (%s)", dial->name,
+				udiald_regstatus_str(dial->regstat));
+			continue;
+		}
+		if (rejected++ >= dial->retries) {
+			udiald_log(LOG_NOTICE, "%s: No carrier although registered (%s), giving up", dial->name,
+				udiald_regstatus_str(dial->regstat));
+			return res;
+		}
+		udiald_log(LOG_NOTICE, "%s: No carrier although registered, retrying in %d ms", dial->name, dial->retry_delay);
+		udiald_clock_sleep_ms(dial->retry_delay);
 	}
+}
 
-	syslog(LOG_ERR, "No complete response received within %zu bytes", lengthof(r->raw_buf));
-	errno = ERANGE;
-	return -1;
+// Does line start with the prefix of one of the given queries?
+static bool udiald_tty_batch_claimed(struct udiald_tty_query *q, size_t n, const char *line) {
+	for (size_t i = 0; i < n; ++i)
+		if (q[i].prefix && !strncmp(line, q[i].prefix, strlen(q[i].prefix)))
+			return true;
+	return false;
+}
+
+// Split the combined response r to a batch into a response for each
+// query and pass those to the callbacks. Information lines starting
+// with the prefix of a query belong to that query. Lines without a
+// known prefix belong to the query without a prefix before them, one
+// line per query when several of those follow each other (e.g.
+// +CGMI;+CGMM). Every query gets the final result line as well.
+static void udiald_tty_batch_split(struct udiald_tty_query *q, size_t n, enum udiald_atres res, struct udiald_tty_read *r) {
+	static char **split;
+	static size_t split_size;
+
+	size_t info = r->lines - 1;
+	if (info + n > split_size) {
+		char **s = realloc(split, (info + n) * sizeof(*split));
+		if (!s) {
+			udiald_log(LOG_ERR, "Failed to allocate room for %zu lines", info + n);
+			for (size_t i = 0; i < n; ++i)
+				q[i].cb(&q[i], UDIALD_FAIL, r);
+			return;
+		}
+		split = s;
+		split_size = info + n;
+	}
+
+	size_t line = 0, out = 0;
+	struct udiald_tty_read sub[n];
+	for (size_t i = 0; i < n; ++i) {
+		udiald_tty_read_init(&sub[i]);
+		sub[i].raw_lines = split + out;
+		sub[i].remaining = r->remaining;
+		sub[i].cme_error = r->cme_error;
+
+		if (q[i].prefix) {
+			while (line < info && !strncmp(r->raw_lines[line], q[i].prefix, strlen(q[i].prefix))) {
+				if (!sub[i].result_line)
+					sub[i].result_line = r->raw_lines[line];
+				split[out++] = r->raw_lines[line++];
+			}
+		} else {
+			bool single = (i + 1 < n && !q[i + 1].prefix);
+			while (line < info && !udiald_tty_batch_claimed(q + i + 1, n - i - 1, r->raw_lines[line])) {
+				split[out++] = r->raw_lines[line++];
+				if (single)
+					break;
+			}
+		}
+		split[out++] = r->raw_lines[info];
+		sub[i].lines = split + out - sub[i].raw_lines;
+	}
+
+	for (; line < info; ++line)
+		udiald_log(LOG_DEBUG, "Ignoring unexpected line in batched response: %s", r->raw_lines[line]);
+
+	for (size_t i = 0; i < n; ++i)
+		q[i].cb(&q[i], res, &sub[i]);
+}
+
+// Send a series of query commands and pass the responses to their
+// callbacks, in order. The commands are joined with ';' into a single
+// command line, so they only take a single round trip to the modem.
+// When nobatch is set, or when the modem rejects the combined command
+// line, each command is sent on its own instead.
+//
+// The responses passed to the callbacks point into the receive buffer,
+// so they are only valid during the callback. Callbacks should not
+// access the tty themselves.
+void udiald_tty_batch(int fd, struct udiald_tty_query *q, size_t n, bool nobatch) {
+	struct iovec iov[2 * n + 1];
+	struct udiald_tty_read r;
+	enum udiald_atres res = UDIALD_FAIL;
+
+	if (!nobatch && n > 1) {
+		// AT<cmd>;<cmd>;...\r, sent with a single write
+		int timeout = 0;
+		for (size_t i = 0; i < n; ++i) {
+			iov[2 * i].iov_base = i ? ";" : "AT";
+			iov[2 * i].iov_len = i ? 1 : 2;
+			iov[2 * i + 1].iov_base = (char *)q[i].command;
+			iov[2 * i + 1].iov_len = strlen(q[i].command);
+			timeout += q[i].timeout;
+		}
+		iov[2 * n].iov_base = "\r";
+		iov[2 * n].iov_len = 1;
+
+		if (udiald_tty_putv(fd, iov, 2 * n + 1) >= 0)
+			res = udiald_tty_get(fd, &r, NULL, timeout);
+		else
+			udiald_tty_read_init(&r);
+
+		if (res == UDIALD_AT_OK) {
+			udiald_tty_batch_split(q, n, res, &r);
+			return;
+		}
+		// When the modem did not answer at all, sending the
+		// commands one by one will not help
+		if (res != UDIALD_AT_ERROR && res != UDIALD_AT_CMEERROR && res != UDIALD_AT_CMSERROR) {
+			for (size_t i = 0; i < n; ++i)
+				q[i].cb(&q[i], res, &r);
+			return;
+		}
+		udiald_log(LOG_INFO, "Batched command failed (%s), sending commands one by one", udiald_tty_flatten_result(&r));
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		iov[0].iov_base = "AT";
+		iov[0].iov_len = 2;
+		iov[1].iov_base = (char *)q[i].command;
+		iov[1].iov_len = strlen(q[i].command);
+		iov[2].iov_base = "\r";
+		iov[2].iov_len = 1;
+		if (udiald_tty_putv(fd, iov, 3) >= 0)
+			res = udiald_tty_get(fd, &r, q[i].prefix, q[i].timeout);
+		else {
+			udiald_tty_read_init(&r);
+			res = UDIALD_FAIL;
+		}
+		q[i].cb(&q[i], res, &r);
+	}
+}
+
+static void udiald_tty_ready_sim_cb(struct udiald_tty_query *q, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_tty_ready *ready = q->priv;
+	enum udiald_sim_state sim;
+	// While it is still initializing, the SIM might report
+	// +CME ERROR: 14 (SIM busy)
+	ready->sim = res == UDIALD_AT_OK && !udiald_parse_cpin(r->result_line, &sim) && sim == UDIALD_SIM_READY;
+}
+
+static void udiald_tty_ready_reg_cb(struct udiald_tty_query *q, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_tty_ready *ready = q->priv;
+	struct udiald_creg reg;
+	// Waiting longer does not help when registration was denied, so
+	// that counts as settled as well
+	ready->registered = res == UDIALD_AT_OK && !udiald_parse_creg(r->result_line, false, &reg)
+		&& (reg.stat == UDIALD_REG_HOME || reg.stat == UDIALD_REG_ROAMING || reg.stat == UDIALD_REG_DENIED);
+}
+
+// Poll the modem every ready->poll ms until the SIM is ready and (with
+// ready->registration) the circuit switched registration has settled,
+// for at most ready->timeout ms. Returns whether the modem became
+// ready; ready->sim, ready->registered and ready->elapsed are set
+// either way.
+//
+// The queries share the time budget: each one may take at most a
+// (2 * n)th of what is left, since a batch that is rejected is sent
+// again one command at a time. So a modem that stops answering does not
+// keep us waiting beyond ready->timeout.
+bool udiald_tty_wait_ready(int fd, struct udiald_tty_ready *ready) {
+	struct udiald_tty_query q[] = {
+		{ .command = "+CPIN?", .prefix = "+CPIN: ", .cb = udiald_tty_ready_sim_cb, .priv = ready },
+		{ .command = "+CREG?", .prefix = "+CREG: ", .cb = udiald_tty_ready_reg_cb, .priv = ready },
+	};
+	size_t n = ready->registration ? lengthof(q) : 1;
+	int64_t start = udiald_util_now_ms(), deadline = start + ready->timeout;
+
+	while (true) {
+		int64_t remaining = deadline - udiald_util_now_ms();
+		for (size_t i = 0; i < n; ++i)
+			q[i].timeout = remaining / (2 * n) < 2500 ? remaining / (2 * n) : 2500;
+
+		ready->sim = false;
+		ready->registered = !ready->registration;
+		udiald_tty_batch(fd, q, n, ready->nobatch);
+		if (ready->sim && ready->registered)
+			break;
+		if (udiald_util_now_ms() + ready->poll >= deadline) {
+			udiald_log(LOG_NOTICE, "%s: %s after %d ms, going on anyway", ready->name,
+				ready->sim ? "Not registered" : "SIM not ready", ready->timeout);
+			break;
+		}
+		udiald_clock_sleep_ms(ready->poll);
+	}
+
+	ready->elapsed = udiald_util_now_ms() - start;
+	return ready->sim && ready->registered;
 }
 
 int udiald_tty_cloexec(int fd) {
@@ -208,7 +958,7 @@ pid_t udiald_tty_pppd(struct udiald_state *state) {
 	char cpath[18 + sizeof(state->networkname) + sizeof(pid_t) * 3];
 	snprintf(cpath, sizeof(cpath), "/tmp/udiald-pppd-%s-%d", state->networkname, getpid());
 	if (unlink(cpath) < 0 && errno != ENOENT) {
-		syslog(LOG_CRIT, "%s: Failed to clean up existing ppp config file: %s",
+		udiald_log(LOG_CRIT, "%s: Failed to clean up existing ppp config file: %s",
 				state->modem.device_id, strerror(errno));
 		return 0;
 	}
@@ -217,20 +967,22 @@ pid_t udiald_tty_pppd(struct udiald_state *state) {
 	FILE *fp;
 	int cfd = open(cpath, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
 	if (cfd < 0) {
-		syslog(LOG_CRIT, "%s: Failed to create ppp config file: %s",
+		udiald_log(LOG_CRIT, "%s: Failed to create ppp config file: %s",
 				state->modem.device_id, strerror(errno));
 		return 0;
 	}
 
 	if (!(fp = fdopen(cfd, "w"))) {
-		syslog(LOG_CRIT, "%s: Failed to create FILE* for ppp config file: %s",
+		udiald_log(LOG_CRIT, "%s: Failed to create FILE* for ppp config file: %s",
 				state->modem.device_id, strerror(errno));
 		close(cfd);
 		return 0;
 	}
 
-	char buf[256];
+	char buf[PATH_MAX + 512];
 
+	if (state->root)
+		fputs(state->root, fp);
 	fputs("/dev/", fp);
 	fputs(state->modem.dat_tty, fp);
 	fputs("\n460800\ncrtscts\nlock\n"
@@ -245,12 +997,18 @@ pid_t udiald_tty_pppd(struct udiald_state *state) {
 
 	// We need to pass ourselve as connect script so get our path from /proc
 	memcpy(buf, "connect \"", 9);
-	ssize_t l = readlink("/proc/self/exe", buf + 9, sizeof(buf) - 10);
+	ssize_t l = readlink("/proc/self/exe", buf + 9, PATH_MAX);
 	/* Pass on relevant options */
 	char *verbose_opts = (verbose == 0 ? "" : verbose == 1 ? " -v" : " -v -v");
-	snprintf(buf + 9 + l, sizeof(buf) - 9 - l, " -d -n%s -D%s -p%s %s\"\n", state->networkname, state->modem.device_id, state->modem.profile->name, verbose_opts);
+	char extra_opts[256] = "";
+	if (state->root)
+		snprintf(extra_opts, sizeof(extra_opts), " --root %s", state->root);
+	/* The dialer appends to our transcript */
+	if (state->transcript)
+		snprintf(extra_opts + strlen(extra_opts), sizeof(extra_opts) - strlen(extra_opts), " --transcript %s", state->transcript);
+	snprintf(buf + 9 + l, sizeof(buf) - 9 - l, " -d -n%s -D%s -p%s%s %s\"\n", state->networkname, state->modem.device_id, state->modem.profile->name, extra_opts, verbose_opts);
 	fputs(buf, fp);
-	printf(buf);
+	fputs(buf, stdout);
 
 	// Set linkname and ipparam
 	fprintf(fp, "linkname \"%s\"\nipparam \"%s\"\n", state->networkname, state->networkname);
@@ -315,18 +1073,49 @@ pid_t udiald_tty_pppd(struct udiald_state *state) {
 	}
 	fclose(fp);
 
-	char *const argv[] = {"/usr/sbin/pppd", "file", cpath, NULL};
+	char *const argv[] = {(char *)state->pppd_path, "file", cpath, NULL};
 	pid_t pid = vfork();
 	if (pid == 0) {
 		execv(argv[0], argv);
+		// Not through the log queue, which belongs to the parent
 		syslog(LOG_CRIT, "%s: Failed to exec %s: %s",
 				state->modem.device_id, argv[0], strerror(errno));
 		_exit(128);
 	} else if (pid == -1) {
-		syslog(LOG_CRIT, "%s: Failed to fork for pppd: %s",
+		udiald_log(LOG_CRIT, "%s: Failed to fork for pppd: %s",
 				state->modem.device_id, strerror(errno));
 		return 0;
 	} else {
 		return pid;
 	}
 }
+
+/**
+ * Returns whether the ppp interface of the pppd started by
+ * udiald_tty_pppd is up. pppd writes the interface name to the second
+ * line of its link pidfile once the interface exists and only sets
+ * the interface up when IPCP has completed.
+ */
+bool udiald_tty_ppp_up(struct udiald_state *state) {
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/var/run/ppp-%s.pid", state->root ? state->root : "", state->networkname);
+
+	FILE *fp = fopen(path, "r");
+	if (!fp)
+		return false;
+
+	struct ifreq ifr = {};
+	char line[32];
+	bool found = fgets(line, sizeof(line), fp) && fgets(ifr.ifr_name, sizeof(ifr.ifr_name), fp);
+	fclose(fp);
+	if (!found)
+		return false;
+	ifr.ifr_name[strcspn(ifr.ifr_name, "\n")] = '\0';
+
+	int sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (sock < 0)
+		return false;
+	int ret = ioctl(sock, SIOCGIFFLAGS, &ifr);
+	close(sock);
+	return ret == 0 && (ifr.ifr_flags & IFF_UP);
+}
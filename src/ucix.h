@@ -124,6 +124,15 @@ static inline int ucix_save(struct uci_context *ctx, const char *p)
 	return 0;
 }
 
+/* Drop the loaded package, so it is loaded again (including changes
+ * saved by other processes) on the next access */
+static inline void ucix_unload(struct uci_context *ctx, const char *p)
+{
+	if(ucix_get_ptr(ctx, p, NULL, NULL, NULL))
+		return;
+	uci_unload(ctx, uci_ptr.p);
+}
+
 static inline int ucix_commit(struct uci_context *ctx, const char *p)
 {
 	if(ucix_get_ptr(ctx, p, NULL, NULL, NULL))
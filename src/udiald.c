@@ -33,12 +33,16 @@
 #include <time.h>
 #include <getopt.h>
 #include <limits.h>
+#include <fcntl.h>
 
 #include "udiald.h"
 #include "config.h"
 
 static volatile int signaled = 0;
-static struct udiald_state state = {.uciname = "network", .networkname = "wan", .format = UDIALD_FORMAT_JSON};
+// Written to when a signal is caught, so the event loop also notices
+// signals arriving just before it starts (see udiald_status_mainloop)
+static volatile int signal_pipe = -1;
+static struct udiald_state state = {.uciname = "network", .networkname = "wan", .format = UDIALD_FORMAT_JSON, .pppd_path = UDIALD_PPPD};
 int verbose = 0;
 
 // UCI config section to use for global values
@@ -69,12 +73,18 @@ static int udiald_usage(const char *app) {
 			"	-p, --profile <profilename>	Use the profile with the given name instead of autodetecting a\n"
 			"					profile to use. Run with -L to get a list of valid profiles.\n"
 			"       --pin <pin>                     Use the given pin, instead of loading it from the config file\n"
+			"	--transcript <file>		Record all data exchanged with the modem, with timestamps, to\n"
+			"					the given file (see tools/udiald-replay)\n"
+			"	--root <dir>			Look for sysfs, device nodes and the uci config and state\n"
+			"					below the given directory instead of / (for testing)\n"
 			"	--usable			Only consider devices that are usable (i.e., for which a\n"
 			"					configuration profile is available). This is enabled by default\n"
 			"					with --connect, but disabled by default with the listing options.\n"
 			"Connect Options:\n"
 			"	-t				Test state file for previous SIM-unlocking\n"
-			"					errors before attempting to connect\n\n"
+			"					errors before attempting to connect\n"
+			"	--pppd <path>			Run the given pppd binary instead of " UDIALD_PPPD "\n"
+			"	-f json				Print the duration of each connection phase on exit\n\n"
 			"List options (valid for -L and -l):\n"
 			"	-f, --format <format>		Sets the output format. Supported formats are \"json\" and \"id\".\n"
 			"Return Codes:\n"
@@ -95,11 +105,25 @@ static int udiald_usage(const char *app) {
 }
 
 static void udiald_catch_signal(int signal) {
+	udiald_trace(UDIALD_TRACE_SIGNAL, signal, 0, NULL, 0);
 	if (!signaled) signaled = signal;
+	// Stop the event loop, if it is running
+	uloop_end();
+	if (signal_pipe >= 0) {
+		// A full pipe means the loop is woken up already
+		ssize_t ret = write(signal_pipe, "", 1);
+		(void)ret;
+	}
+}
+
+static void udiald_dump_signal(int signal) {
+	udiald_trace(UDIALD_TRACE_SIGNAL, signal, 0, NULL, 0);
+	udiald_util_dump_request();
 }
 
 // Signal safe cleanup function
 static void udiald_cleanup_safe(int signal) {
+	udiald_trace(UDIALD_TRACE_SIGNAL, signal, 0, NULL, 0);
 	if (state.ctlfd > 0) {
 		close(state.ctlfd);
 		state.ctlfd = -1;
@@ -131,9 +155,9 @@ static void udiald_exitcode(int code, const char *fmt, ...) {
 			udiald_config_set(&state, "udiald_error_msg", buf);
 
 			if (state.modem.device_id[0])
-				syslog(LOG_CRIT, "%s: %s", state.modem.device_id, buf);
+				udiald_log(LOG_CRIT, "%s: %s", state.modem.device_id, buf);
 			else
-				syslog(LOG_CRIT, "%s", buf);
+				udiald_log(LOG_CRIT, "%s", buf);
 		} else {
 			udiald_config_revert(&state, "udiald_error_msg");
 		}
@@ -144,13 +168,25 @@ static void udiald_exitcode(int code, const char *fmt, ...) {
 		else
 			udiald_config_revert(&state, "udiald_state");
 	}
-	ucix_save(state.uci, state.uciname);
-	exit(code);
-}
+	udiald_config_save(&state);
+
+	if (state.app == UDIALD_APP_CONNECT && state.flags & UDIALD_FLAG_FORMAT
+	&& state.format == UDIALD_FORMAT_JSON && state.timing_start) {
+		struct json_object *obj = json_object_new_object();
+		json_object_object_add(obj, "timing", udiald_timing_json(&state));
+		printf("%s\n", json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PRETTY));
+		json_object_put(obj);
+	}
 
-static void sleep_seconds(int seconds) {
-	const struct timespec ts = {.tv_sec = seconds};
-	nanosleep(&ts, NULL);
+	udiald_cmdstats_dump(LOG_INFO);
+	udiald_cmdstats_save();
+	// Keep the events leading up to the error
+	if (code != UDIALD_OK && code != UDIALD_ESIGNALED)
+		udiald_trace_dump();
+	const struct udiald_tty_stats *st = udiald_tty_get_stats();
+	udiald_log(LOG_DEBUG, "tty: wrote %lu bytes in %lu calls, read %lu bytes in %lu calls",
+		st->bytes_written, st->writes, st->bytes_read, st->reads);
+	exit(code);
 }
 
 /* Constants to return for long options withou a corresponding short
@@ -163,6 +199,9 @@ enum long_options {
 	UDIALD_OPT_USABLE = UCHAR_MAX + 1,
 	UDIALD_OPT_PROBE,
 	UDIALD_OPT_PIN,
+	UDIALD_OPT_TRANSCRIPT,
+	UDIALD_OPT_ROOT,
+	UDIALD_OPT_PPPD,
 };
 
 static struct option longopts[] = {
@@ -185,6 +224,9 @@ static struct option longopts[] = {
 	{"usable", false, NULL, UDIALD_OPT_USABLE},
 	{"probe", false, NULL, UDIALD_OPT_PROBE},
 	{"pin", true, NULL, UDIALD_OPT_PIN},
+	{"transcript", true, NULL, UDIALD_OPT_TRANSCRIPT},
+	{"root", true, NULL, UDIALD_OPT_ROOT},
+	{"pppd", true, NULL, UDIALD_OPT_PPPD},
 	{0},
 };
 
@@ -195,7 +237,7 @@ static enum udiald_app udiald_parse_cmdline(struct udiald_state *state, int argc
 	enum udiald_app app = UDIALD_APP_CONNECT;
 
 	int s;
-	while ((s = getopt_long(argc, argv, "csuUdn:vtlLV:P:D:p:fq", longopts, NULL)) != -1) {
+	while ((s = getopt_long(argc, argv, "csuUdn:vtlLV:P:D:p:f:q", longopts, NULL)) != -1) {
 		switch(s) {
 			case 'c':
 				app = UDIALD_APP_CONNECT;
@@ -267,7 +309,25 @@ static enum udiald_app udiald_parse_cmdline(struct udiald_state *state, int argc
 			case UDIALD_OPT_PIN:
 				state->pin = strdup(optarg);
 				break;
+			case UDIALD_OPT_TRANSCRIPT:
+				if (strpbrk(optarg, "\" \r\n") || strlen(optarg) > 100) {
+					fprintf(stderr, "Invalid transcript path: \"%s\"\n", optarg);
+					exit(UDIALD_EINVAL);
+				}
+				state->transcript = optarg;
+				break;
+			case UDIALD_OPT_ROOT:
+				if (strpbrk(optarg, "\" \r\n") || strlen(optarg) > 100) {
+					fprintf(stderr, "Invalid root directory: \"%s\"\n", optarg);
+					exit(UDIALD_EINVAL);
+				}
+				state->root = optarg;
+				break;
+			case UDIALD_OPT_PPPD:
+				state->pppd_path = optarg;
+				break;
 			case 'f':
+				state->flags |= UDIALD_FLAG_FORMAT;
 				if (!strcmp(optarg, "json")) {
 					state->format = UDIALD_FORMAT_JSON;
 				} else if (!strcmp(optarg, "id")) {
@@ -293,24 +353,25 @@ static void udiald_setup_syslog(struct udiald_state *state) {
 	if (state->app == UDIALD_APP_DIAL)
 		appname = "udiald-dialer";
 
-	openlog(appname, LOG_PID | LOG_PERROR, LOG_USER);
-
+	int mask;
 	if (verbose > 1 ) // Log everything
-		setlogmask(LOG_UPTO(LOG_DEBUG));
+		mask = LOG_UPTO(LOG_DEBUG);
 	else if (verbose == 1 )
-		setlogmask(LOG_UPTO(LOG_INFO));
+		mask = LOG_UPTO(LOG_INFO);
 	else if (verbose == 0 )
-		setlogmask(LOG_UPTO(LOG_NOTICE));
+		mask = LOG_UPTO(LOG_NOTICE);
 	else if (verbose == -1 )
-		setlogmask(LOG_UPTO(LOG_WARNING));
-	else if (verbose < -1 ) // Log nothing. We can't pass 0, so just
-				// enable all non-relevant bits instead.
-		setlogmask(INT_MAX & ~(LOG_UPTO(LOG_DEBUG)));
+		mask = LOG_UPTO(LOG_WARNING);
+	else // Log nothing. We can't pass 0, so just
+	     // enable all non-relevant bits instead.
+		mask = INT_MAX & ~(LOG_UPTO(LOG_DEBUG));
+
+	udiald_log_open(appname, LOG_PID | LOG_PERROR, LOG_USER, mask);
 }
 
 static void udiald_setup_uci(struct udiald_state *state) {
 	// Prepare and initialize state
-	if (!(state->uci = ucix_init(state->uciname, 1))) {
+	if (!(state->uci = ucix_init_path(state->root, state->uciname, 1))) {
 		exit(UDIALD_EINTERNAL);
 	}
 	ucix_add_section(state->uci, state->uciname, UCI_SECTION_GLOBAL, "udiald");
@@ -334,11 +395,16 @@ void udiald_select_modem(struct udiald_state *state) {
 	}
 	char b[512] = {0};
 	snprintf(b, sizeof(b), "%04x:%04x", state->modem.vendor, state->modem.device);
-	syslog(LOG_NOTICE, "%s: Found %s modem %s", state->modem.device_id,
+	udiald_log(LOG_NOTICE, "%s: Found %s modem %s", state->modem.device_id,
 			state->modem.driver, b);
 	udiald_config_set(state, "modem_id", b);
 	udiald_config_set(state, "modem_driver", state->modem.driver);
 
+	// Response times seen before with this profile, to adapt timeouts
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s%s", state->root ? state->root : "", UDIALD_LATENCY_HISTORY);
+	udiald_cmdstats_load(path, state->modem.profile->name);
+
 	b[0] = '\0';
 	// Writing modestrings
 	const struct udiald_config *cfg = &state->modem.profile->cfg;
@@ -348,7 +414,7 @@ void udiald_select_modem(struct udiald_state *state) {
 			strncat(b, udiald_modem_modestr(i), sizeof(b) - strlen(b) - 2);
 			strcat(b, " ");
 		}
-	syslog(LOG_NOTICE, "%s: Configuration profile supports modes: %s", state->modem.device_id, b);
+	udiald_log(LOG_NOTICE, "%s: Configuration profile supports modes: %s", state->modem.device_id, b);
 }
 
 /**
@@ -356,8 +422,8 @@ void udiald_select_modem(struct udiald_state *state) {
  */
 static void udiald_open_control(struct udiald_state *state) {
 	// Open control connection
-	char ttypath[24];
-	snprintf(ttypath, sizeof(ttypath), "/dev/%s", state->modem.ctl_tty);
+	char ttypath[PATH_MAX];
+	snprintf(ttypath, sizeof(ttypath), "%s/dev/%s", state->root ? state->root : "", state->modem.ctl_tty);
 	if ((state->ctlfd = udiald_tty_cloexec(udiald_tty_open(ttypath))) == -1) {
 		udiald_exitcode(UDIALD_EMODEM, "Unable to open terminal");
 	}
@@ -369,43 +435,60 @@ static void udiald_open_control(struct udiald_state *state) {
 static void udiald_modem_reset(struct udiald_state *state) {
 	struct udiald_tty_read r;
 	// Hangup modem, disable echoing
-	tcflush(state->ctlfd, TCIFLUSH);
+	udiald_tty_flush(state->ctlfd);
 	udiald_tty_put(state->ctlfd, "ATE0\r");
 	udiald_tty_get(state->ctlfd, &r, NULL, 2500);
-	tcflush(state->ctlfd, TCIFLUSH);
+	udiald_tty_flush(state->ctlfd);
 }
 
+/* Startup queries that need to share some data */
+struct udiald_startup {
+	struct udiald_state *state;
+	char name[512];
+};
+
 /**
- * Query the modem for identification.
+ * Store the manufacturer, from the response to AT+CGMI.
  */
-static void udiald_identify(struct udiald_state *state) {
-	struct udiald_tty_read r;
-	char b[512];
-	// Identify modem
-	if (udiald_tty_put(state->ctlfd, "AT+CGMI;+CGMM\r") < 1
-	|| udiald_tty_get(state->ctlfd, &r, NULL, 2500) != UDIALD_AT_OK
-	|| r.lines < 3) {
+static void udiald_manufacturer_cb(struct udiald_tty_query *q, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_startup *st = q->priv;
+	if (res != UDIALD_AT_OK || r->lines < 2) {
 		udiald_exitcode(UDIALD_EMODEM, "Unable to identify modem");
 	}
-	snprintf(b, sizeof(b), "%s %s", r.raw_lines[0], r.raw_lines[1]);
-	syslog(LOG_NOTICE, "%s: Identified as %s", state->modem.device_id, b);
-	udiald_config_set(state, "modem_name", b);
+	snprintf(st->name, sizeof(st->name), "%s", r->raw_lines[0]);
+}
+
+/**
+ * Identify the modem, using the manufacturer and the response to
+ * AT+CGMM.
+ */
+static void udiald_identify_cb(struct udiald_tty_query *q, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_startup *st = q->priv;
+	struct udiald_state *state = st->state;
+	if (res != UDIALD_AT_OK || r->lines < 2) {
+		udiald_exitcode(UDIALD_EMODEM, "Unable to identify modem");
+	}
+	size_t len = strlen(st->name);
+	snprintf(st->name + len, sizeof(st->name) - len, " %s", r->raw_lines[0]);
+	udiald_log(LOG_NOTICE, "%s: Identified as %s", state->modem.device_id, st->name);
+	udiald_config_set(state, "modem_name", st->name);
+	udiald_timing_mark(state, UDIALD_PHASE_IDENTIFY);
 }
 
 static void udiald_probe_cmd(struct udiald_state *state, const char *cmd, int timeout) {
 	char b[512] = {0};
 	struct udiald_tty_read r;
-	syslog(LOG_NOTICE, "Sending %s", cmd);
+	udiald_log(LOG_NOTICE, "Sending %s", cmd);
 	snprintf(b, sizeof(b) - 1, "%s\r", cmd);
 	if (udiald_tty_put(state->ctlfd, b) < 1
 	|| udiald_tty_get(state->ctlfd, &r, NULL, timeout) != UDIALD_AT_OK) {
-		syslog(LOG_CRIT, "%s: %s failed (%s)", state->modem.device_id, cmd, udiald_tty_flatten_result(&r));
+		udiald_log(LOG_CRIT, "%s: %s failed (%s)", state->modem.device_id, cmd, udiald_tty_flatten_result(&r));
 	} else {
 		for (size_t i = 0; i < r.lines; ++i) {
 			if (strstr(r.raw_lines[i], "IMEI"))
-				syslog(LOG_NOTICE, "<IMEI censored by udiald>");
+				udiald_log(LOG_NOTICE, "<IMEI censored by udiald>");
 			else
-				syslog(LOG_NOTICE, r.raw_lines[i]);
+				udiald_log(LOG_NOTICE, "%s", r.raw_lines[i]);
 		}
 	}
 }
@@ -415,7 +498,9 @@ static void udiald_probe_cmd(struct udiald_state *state, const char *cmd, int ti
  * debug measure only).
  */
 static void udiald_probe(struct udiald_state *state) {
-        syslog(LOG_NOTICE, "Starting probe");
+	// All responses are wanted, however many lines they have
+	udiald_log_setlimit(false);
+        udiald_log(LOG_NOTICE, "Starting probe");
 	// Diagnostic info
 	udiald_probe_cmd(state, "ATI", 2500);
 	// Manufacturer information
@@ -470,20 +555,20 @@ static void udiald_probe(struct udiald_state *state) {
 	// Available networks (read using a longer timeout, this command
 	// may take a while)
 	udiald_probe_cmd(state, "AT+COPS=?", 45000);
-        syslog(LOG_NOTICE, "Probe finished");
+        udiald_log(LOG_NOTICE, "Probe finished");
+	udiald_log_setlimit(true);
 }
 
 /**
- * Query the modem for its SIM status.
+ * Evaluate the SIM status, using the response to AT+CPIN?.
  */
-static void udiald_check_sim(struct udiald_state *state) {
-	struct udiald_tty_read r;
-	// Getting SIM state
-	tcflush(state->ctlfd, TCIFLUSH);
-	if (udiald_tty_put(state->ctlfd, "AT+CPIN?\r") < 1
-	|| udiald_tty_get(state->ctlfd, &r, "+CPIN: ", 2500) != UDIALD_AT_OK
-	|| r.result_line == NULL) {
-		syslog(LOG_CRIT, "%s: Unable to get SIM status (%s)", state->modem.device_id, udiald_tty_flatten_result(&r));
+static void udiald_check_sim_cb(struct udiald_tty_query *q, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_startup *st = q->priv;
+	struct udiald_state *state = st->state;
+	enum udiald_sim_state sim;
+	udiald_timing_mark(state, UDIALD_PHASE_CHECK_SIM);
+	if (res != UDIALD_AT_OK || udiald_parse_cpin(r->result_line, &sim)) {
+		udiald_log(LOG_CRIT, "%s: Unable to get SIM status (%s)", state->modem.device_id, udiald_tty_flatten_result(r));
 		udiald_config_set(state, "sim_state", "error");
 		state->sim_state = -1;
 		if (state->app != UDIALD_APP_PROBE)
@@ -492,26 +577,81 @@ static void udiald_check_sim(struct udiald_state *state) {
 	}
 
 	// Evaluate SIM state
-	if (!strcmp(r.result_line, "+CPIN: READY")) {
-		syslog(LOG_NOTICE, "%s: SIM card is ready", state->modem.device_id);
+	if (sim == UDIALD_SIM_READY) {
+		udiald_log(LOG_NOTICE, "%s: SIM card is ready", state->modem.device_id);
 		udiald_config_set(state, "sim_state", "ready");
 		state->sim_state = 0;
-	} else if (!strcmp(r.result_line, "+CPIN: SIM PIN")) {
-		syslog(LOG_NOTICE, "%s: SIM card requires pin", state->modem.device_id);
+	} else if (sim == UDIALD_SIM_PIN) {
+		udiald_log(LOG_NOTICE, "%s: SIM card requires pin", state->modem.device_id);
 		udiald_config_set(state, "sim_state", "wantpin");
 		state->sim_state = 1;
-	} else if (!strcmp(r.result_line, "+CPIN: SIM PUK")) {
-		syslog(LOG_WARNING, "%s: SIM requires PUK!", state->modem.device_id);
+	} else if (sim == UDIALD_SIM_PUK) {
+		udiald_log(LOG_WARNING, "%s: SIM requires PUK!", state->modem.device_id);
 		udiald_config_set(state, "sim_state", "wantpuk");
 		state->sim_state = 2;
 	} else {
 		udiald_config_set(state, "sim_state", "error");
 		state->sim_state = -1;
 		if (state->app != UDIALD_APP_PROBE)
-			udiald_exitcode(UDIALD_ESIM, "Unknown SIM status (%s)", r.result_line);
+			udiald_exitcode(UDIALD_ESIM, "Unknown SIM status (%s)", r->result_line);
 		else
-			syslog(LOG_CRIT, "%s: Unknown SIM status (%s)", state->modem.device_id, r.result_line);
+			udiald_log(LOG_CRIT, "%s: Unknown SIM status (%s)", state->modem.device_id, r->result_line);
+	}
+}
+
+/**
+ * Evaluate the supported capabilities, using the response to AT+GCAP.
+ */
+static void udiald_check_caps_cb(struct udiald_tty_query *q, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_startup *st = q->priv;
+	struct udiald_state *state = st->state;
+	unsigned caps;
+	state->is_gsm = 0;
+	if (res == UDIALD_AT_OK && !udiald_parse_gcap(r->result_line, &caps)) {
+		if (caps & UDIALD_GCAP_GSM) {
+			state->is_gsm = 1;
+			udiald_config_set(state, "modem_gsm", "1");
+			udiald_log(LOG_NOTICE, "%s: Detected a GSM modem", state->modem.device_id);
+		}
+	}
+}
+
+/**
+ * Query the modem for identification, SIM status and capabilities.
+ *
+ * These are sent as a single command line, unless the profile says the
+ * modem cannot handle that.
+ */
+static void udiald_query_modem(struct udiald_state *state) {
+	struct udiald_startup st = { .state = state };
+	struct udiald_tty_query q[] = {
+		{ .command = "+CGMI", .timeout = 2500, .cb = udiald_manufacturer_cb, .priv = &st },
+		{ .command = "+CGMM", .timeout = 2500, .cb = udiald_identify_cb, .priv = &st },
+		{ .command = "+CPIN?", .prefix = "+CPIN: ", .timeout = 2500, .cb = udiald_check_sim_cb, .priv = &st },
+		{ .command = "+GCAP", .prefix = "+GCAP: ", .timeout = 2500, .cb = udiald_check_caps_cb, .priv = &st },
+	};
+	bool nobatch = state->modem.profile->cfg.flags & UDIALD_CONFIG_NOBATCH;
+	struct udiald_identity *id = &state->identity;
+
+	// When connecting with a modem seen before, only the SIM status
+	// needs to be asked for. The identity is checked again once
+	// connected (see udiald_status_ident_done).
+	udiald_idcache_init(state, id);
+	if (state->app == UDIALD_APP_CONNECT && udiald_idcache_lookup(state, id)) {
+		udiald_log(LOG_NOTICE, "%s: Identified as %s (cached)", state->modem.device_id, id->name);
+		udiald_config_set(state, "modem_name", id->name);
+		udiald_timing_mark(state, UDIALD_PHASE_IDENTIFY);
+		state->is_gsm = id->gsm;
+		if (state->is_gsm)
+			udiald_config_set(state, "modem_gsm", "1");
+		udiald_tty_batch(state->ctlfd, &q[2], 1, nobatch);
+		return;
 	}
+
+	udiald_tty_batch(state->ctlfd, q, lengthof(q), nobatch);
+	snprintf(id->name, sizeof(id->name), "%s", st.name);
+	id->gsm = state->is_gsm;
+	udiald_idcache_store(state, id);
 }
 
 /**
@@ -536,10 +676,9 @@ static void udiald_enter_puk(struct udiald_state *state, const char *puk, const
 
 	// Send command
 	struct udiald_tty_read r;
-	tcflush(state->ctlfd, TCIFLUSH);
 	if (udiald_tty_put(state->ctlfd, b) >= 0
 	&& udiald_tty_get(state->ctlfd, &r, NULL, 2500) == UDIALD_AT_OK) {
-		syslog(LOG_NOTICE, "%s: PIN reset successful", state->modem.device_id);
+		udiald_log(LOG_NOTICE, "%s: PIN reset successful", state->modem.device_id);
 		udiald_config_set(state, "sim_state", "ready");
 		udiald_exitcode(UDIALD_OK, NULL);
 	} else {
@@ -547,6 +686,41 @@ static void udiald_enter_puk(struct udiald_state *state, const char *puk, const
 	}
 }
 
+// Longest time to wait for the modem to become ready after entering
+// the PIN (in ms), before going on anyway
+#define UDIALD_READY_TIMEOUT 5000
+// Interval between readiness checks (in ms)
+#define UDIALD_READY_POLL 250
+
+/**
+ * Wait for the modem to be ready after entering the PIN: the SIM must
+ * be ready and the modem registered to a network. This gives up after
+ * UDIALD_READY_TIMEOUT ms, since dialing retries while there is no
+ * carrier anyway. Profiles can ask for a minimum delay (pin_delay),
+ * which is waited for even when the modem reports ready earlier.
+ *
+ * When connecting, only the SIM is waited for: the dialer waits for
+ * packet service registration itself.
+ */
+static void udiald_wait_ready(struct udiald_state *state) {
+	const struct udiald_config *cfg = &state->modem.profile->cfg;
+	struct udiald_tty_ready ready = {
+		.name = state->modem.device_id,
+		.timeout = UDIALD_READY_TIMEOUT,
+		.poll = UDIALD_READY_POLL,
+		.registration = state->app != UDIALD_APP_CONNECT,
+		.nobatch = cfg->flags & UDIALD_CONFIG_NOBATCH,
+	};
+	udiald_tty_wait_ready(state->ctlfd, &ready);
+
+	if (ready.elapsed < cfg->pin_delay) {
+		udiald_log(LOG_INFO, "%s: Waiting %d ms more for the modem to settle", state->modem.device_id, cfg->pin_delay - ready.elapsed);
+		udiald_clock_sleep_ms(cfg->pin_delay - ready.elapsed);
+	} else {
+		udiald_log(LOG_INFO, "%s: Modem ready after %d ms", state->modem.device_id, ready.elapsed);
+	}
+}
+
 /**
  * Unlock the device using the PIN.
  *
@@ -563,7 +737,7 @@ static void udiald_enter_pin(struct udiald_state *state) {
 		if (state->app != UDIALD_APP_PROBE)
 			udiald_exitcode(UDIALD_EUNLOCK, "No PIN configured");
 		else
-			syslog(LOG_CRIT, "%s: No PIN configured", state->modem.device_id);
+			udiald_log(LOG_CRIT, "%s: No PIN configured", state->modem.device_id);
 		free(pin);
 		return;
 	}
@@ -571,7 +745,7 @@ static void udiald_enter_pin(struct udiald_state *state) {
 		if (state->app != UDIALD_APP_PROBE)
 			udiald_exitcode(UDIALD_EINVAL, "Invalid PIN configured (%s)", pin);
 		else
-			syslog(LOG_CRIT, "%s: Invalid PIN configured (%s)", state->modem.device_id, pin);
+			udiald_log(LOG_CRIT, "%s: Invalid PIN configured (%s)", state->modem.device_id, pin);
 		free(pin);
 		return;
 	}
@@ -581,7 +755,7 @@ static void udiald_enter_pin(struct udiald_state *state) {
 		if (state->app != UDIALD_APP_PROBE)
 			udiald_exitcode(UDIALD_ESIM, "Not retrying previously failed pin (%s)", failed);
 		else
-			syslog(LOG_CRIT, "%s: Not retrying previously failed PIN (%s)", state->modem.device_id, failed);
+			udiald_log(LOG_CRIT, "%s: Not retrying previously failed PIN (%s)", state->modem.device_id, failed);
 		free(pin);
 		return;
 	}
@@ -591,50 +765,85 @@ static void udiald_enter_pin(struct udiald_state *state) {
 
 	// Send command
 	struct udiald_tty_read r;
-	tcflush(state->ctlfd, TCIFLUSH);
 	if (udiald_tty_put(state->ctlfd, b) < 0
 	|| udiald_tty_get(state->ctlfd, &r, NULL, 2500) != UDIALD_AT_OK) {
 		ucix_add_option(state->uci, state->uciname, UCI_SECTION_GLOBAL, "failed_pin", pin);
 		if (state->app != UDIALD_APP_PROBE)
 			udiald_exitcode(UDIALD_EUNLOCK, "PIN %s rejected (%s)", pin, udiald_tty_flatten_result(&r));
 		else
-			syslog(LOG_CRIT, "%s: PIN %s rejected (%s)", state->modem.device_id, pin, udiald_tty_flatten_result(&r));
+			udiald_log(LOG_CRIT, "%s: PIN %s rejected (%s)", state->modem.device_id, pin, udiald_tty_flatten_result(&r));
 		free(pin);
 		return;
 	}
 	free(pin);
 
-	syslog(LOG_NOTICE, "%s: PIN accepted", state->modem.device_id);
+	udiald_log(LOG_NOTICE, "%s: PIN accepted", state->modem.device_id);
 	udiald_config_set(state, "sim_state", "ready");
 
-	// Wait a few seconds for the dongle to find a carrier.
-	// Some dongles apparently do not send a NO CARRIER reply to the
-	// dialing, but instead hang up directly after sending a CONNECT
-	// reply (Alcatel X060S / 1bbb:0000 showed this problem).
-	sleep_seconds(5);
+	// Wait for the dongle to find a carrier before dialing.
+	udiald_wait_ready(state);
 }
 
 /**
- * Query the device for supported capabilities.
+ * Set up the PDP context with the configured APN, so the network can
+ * be attached to before dialing (see udiald_status_attach_cb) and the
+ * dialer only has to dial. The APN is
+ * stored in the state (pdp_apn), which tells the dialer that the
+ * context is set up already. When this fails, the dialer tries again.
  */
-static void udiald_check_caps(struct udiald_state *state) {
+static void udiald_set_context(struct udiald_state *state) {
 	struct udiald_tty_read r;
-	state->is_gsm = 0;
-	if (udiald_tty_put(state->ctlfd, "AT+GCAP\r") >= 0
-	&& udiald_tty_get(state->ctlfd, &r, "+GCAP: ", 2500) == UDIALD_AT_OK
-	&& r.result_line) {
-		if (strstr(r.result_line, "CGSM")) {
-			state->is_gsm = 1;
-			udiald_config_set(state, "modem_gsm", "1");
-			syslog(LOG_NOTICE, "%s: Detected a GSM modem", state->modem.device_id);
-		}
+	char b[512];
+	char *apn = udiald_config_get(state, "udiald_apn");
+
+	udiald_config_revert(state, "pdp_apn");
+	if (apn && strpbrk(apn, "\"\r\n;")) {
+		// The dialer reports this
+		free(apn);
+		return;
 	}
+
+	snprintf(b, sizeof(b), "AT+CGDCONT=1,\"IP\",\"%s\"\r", apn ? apn : "");
+	if (udiald_tty_put(state->ctlfd, b) < 0
+	|| udiald_tty_get(state->ctlfd, &r, NULL, 2500) != UDIALD_AT_OK) {
+		udiald_log(LOG_WARNING, "%s: Failed to set up PDP context (%s)", state->modem.device_id, udiald_tty_flatten_result(&r));
+	} else {
+		udiald_log(LOG_NOTICE, "%s: PDP context set up for APN \"%s\"", state->modem.device_id, apn ? apn : "");
+		udiald_config_set(state, "pdp_apn", apn ? apn : "");
+	}
+	free(apn);
+}
+
+/**
+ * Check whether the modem is in the given mode already, using the
+ * profile's mode query. Returns false when the profile has no way to
+ * tell.
+ */
+static bool udiald_mode_is_set(struct udiald_state *state, enum udiald_mode mode) {
+	const struct udiald_config *cfg = &state->modem.profile->cfg;
+	struct udiald_tty_read r;
+	char prefix[32];
+	if (!cfg->modequery || !cfg->modecheck[mode])
+		return false;
+
+	// The response starts like the expected one, up to the colon
+	// (e.g. "^SYSCFG:"). Passing it on keeps the response from
+	// being taken for an unsolicited one.
+	snprintf(prefix, sizeof(prefix), "%.*s", (int)strcspn(cfg->modecheck[mode], ":") + 1, cfg->modecheck[mode]);
+	if (udiald_tty_put(state->ctlfd, cfg->modequery) < 0
+	|| udiald_tty_get(state->ctlfd, &r, prefix, 2500) != UDIALD_AT_OK) {
+		udiald_log(LOG_INFO, "%s: Failed to query mode (%s)", state->modem.device_id, udiald_tty_flatten_result(&r));
+		return false;
+	}
+	return !udiald_parse_match(r.result_line, cfg->modecheck[mode]);
 }
 
 /**
  * Set the device mode (GPRS/UMTS).
  *
- * The mode to set is taken from the configuration.
+ * The mode to set is taken from the configuration. Changing the mode
+ * can make the modem register again, so when the profile can query the
+ * mode, it is only changed when it differs.
  */
 static void udiald_set_mode(struct udiald_state *state) {
 	struct udiald_tty_read r;
@@ -644,7 +853,11 @@ static void udiald_set_mode(struct udiald_state *state) {
 		free(m);
 		udiald_exitcode(UDIALD_EINVAL, "Unsupported mode (%s)", udiald_modem_modestr(mode));
 	}
-	tcflush(state->ctlfd, TCIFLUSH);
+	if (state->modem.profile->cfg.modecmd[mode][0] && udiald_mode_is_set(state, mode)) {
+		udiald_log(LOG_NOTICE, "%s: Mode already set to %s", state->modem.device_id, udiald_modem_modestr(mode));
+		free(m);
+		return;
+	}
 	if (state->modem.profile->cfg.modecmd[mode][0]
 	&& (udiald_tty_put(state->ctlfd, state->modem.profile->cfg.modecmd[mode]) < 0
 	|| udiald_tty_get(state->ctlfd, &r, NULL, 5000) != UDIALD_AT_OK)) {
@@ -652,72 +865,372 @@ static void udiald_set_mode(struct udiald_state *state) {
 		udiald_exitcode(UDIALD_EMODEM, "Failed to set mode %s (%s)",
 			state->modem.device_id, udiald_modem_modestr(mode), udiald_tty_flatten_result(&r));
 	}
-	syslog(LOG_NOTICE, "%s: Mode set to %s", state->modem.device_id, udiald_modem_modestr(mode));
+	udiald_log(LOG_NOTICE, "%s: Mode set to %s", state->modem.device_id, udiald_modem_modestr(mode));
 	free(m);
 }
 
-static void udiald_connect_status_mainloop(struct udiald_state *state) {
-	int status = -1;
-	int logsteps = 4;	// Report RSSI / BER to syslog every LOGSTEPS intervals
-	char provider[64] = {0};
-	struct udiald_tty_read r;
+// Interval between provider and RSSI / BER queries while connected (in ms)
+#define UDIALD_STATUS_INTERVAL 15000
+// Interval used instead when the modem reported its RSSI by itself
+// since the previous query (in ms)
+#define UDIALD_STATUS_INTERVAL_PUSHED 60000
+// Report RSSI / BER to syslog every UDIALD_STATUS_LOGSTEPS intervals
+#define UDIALD_STATUS_LOGSTEPS 4
+// Interval for checking whether the ppp link is up yet (in ms)
+#define UDIALD_STATUS_PPP_POLL 200
+
+/* State of the status polling while connected */
+struct udiald_status {
+	struct udiald_state *state;
+	struct udiald_at at;
+	struct uloop_timeout timer;
+	struct uloop_timeout ppp_timer;	/* Polls until the ppp interface is up */
+	struct uloop_fd signal_fd;	/* Read end of signal_pipe */
+	struct udiald_at_cmd attach;
+	struct udiald_at_cmd set_format;
+	struct udiald_at_cmd enable_creg;
+	struct udiald_at_cmd enable_cgreg;
+	struct udiald_at_cmd query;
+	struct udiald_at_cmd ident[4];	/* +CGMI, +CGMM, +GCAP and +CGMR */
+	struct udiald_identity fresh;	/* Identity as reported now */
+	bool ident_failed;
+	struct udiald_urc creg_urc;
+	struct udiald_urc cgreg_urc;
+	struct udiald_urc rssi_urc;
+	struct udiald_urc mode_urc;
+	bool query_pending;	/* query is queued or running */
+	bool rssi_pushed;	/* ^RSSI was received since the last query */
+	int status;
+	char provider[64];
+	struct udiald_csq csq;	/* Last known signal quality */
+	struct udiald_creg creg;	/* Last circuit switched registration */
+	struct udiald_creg cgreg;	/* Last packet switched registration */
+};
 
-	// Set reporting format for AT+COPS? to 0 (long alphanumeric
-	// format), for devices that default to reporting numeric
-	// identifiers only. "3" means to leave actual network selection
-	// parameters unchanged and only set the format.
-	udiald_tty_put(state->ctlfd, "AT+COPS=3,0\r");
-	if (udiald_tty_get(state->ctlfd, &r, NULL, 2500) != UDIALD_AT_OK)
-		syslog(LOG_WARNING, "%s: Failed to set AT+COPS to long format\n", state->modem.device_id);
-
-	// Main loop, wait for termination, measure signal strength
-	while (!signaled) {
-		// First run
-		if (!++status) {
-			udiald_config_set(state, "connected", "1");
-			ucix_save(state->uci, state->uciname);
-		} else {
-			sleep_seconds(15);
-			if (signaled) break;
-		}
+// A signal was caught (see udiald_catch_signal), stop the loop
+static void udiald_status_signal_cb(struct uloop_fd *u, unsigned int events) {
+	uloop_end();
+}
 
-		// Query provider and RSSI / BER
-		tcflush(state->ctlfd, TCIFLUSH);
-/*		udiald_tty_put(state->ctlfd, "AT+CREG?\r");
-		udiald_tty_get(state->ctlfd, b, sizeof(b), 2500);
-		printf("%s:%s[%d]%s\n", __FILE__, __func__, __LINE__, b);
-*/
-		udiald_tty_put(state->ctlfd, "AT+COPS?;+CSQ\r");
-		if (udiald_tty_get(state->ctlfd, &r, NULL, 2500) != UDIALD_AT_OK
-		|| r.lines < 3)
-			continue;
-
-		char *saveptr;
-		char *cops = r.raw_lines[0];
-		char *csq = r.raw_lines[1];
-
-		if (cops && (cops = strchr(cops, '"')) // +COPS: 0,0,"FONIC",2
-		&& (cops = strtok_r(cops, "\"", &saveptr))
-		&& strncmp(cops, provider, sizeof(provider) - 1)) {
-			syslog(LOG_NOTICE, "%s: Provider is %s",
-				state->modem.device_id, cops);
+// Query provider and RSSI now, unless a query is already underway
+static void udiald_status_query_now(struct udiald_status *s) {
+	if (s->query_pending)
+		return;
+	uloop_timeout_cancel(&s->timer);
+	s->query_pending = true;
+	udiald_at_queue(&s->at, &s->query);
+}
+
+static void udiald_status_attach_cb(struct udiald_at_cmd *cmd, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_status *s = cmd->priv;
+	struct udiald_state *state = s->state;
+	if (res != UDIALD_AT_OK) {
+		// Attaching when dialing still works
+		udiald_log(LOG_INFO, "%s: Early attach failed (%s)", state->modem.device_id, udiald_tty_flatten_result(r));
+		return;
+	}
+	udiald_log(LOG_INFO, "%s: Attached to packet service", state->modem.device_id);
+	udiald_timing_mark(state, UDIALD_PHASE_ATTACH);
+	udiald_config_save(state);
+}
+
+// Information line of a response, or NULL
+static const char *udiald_status_info(enum udiald_atres res, struct udiald_tty_read *r) {
+	return (res == UDIALD_AT_OK && r->lines >= 2) ? r->raw_lines[0] : NULL;
+}
+
+static void udiald_status_ident_cb(struct udiald_at_cmd *cmd, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_status *s = cmd->priv;
+	struct udiald_identity *fresh = &s->fresh;
+	const char *info = udiald_status_info(res, r);
+	size_t len = strlen(fresh->name);
+	unsigned caps;
+
+	if (cmd == &s->ident[0] || cmd == &s->ident[1]) {
+		// Manufacturer and model, just like udiald_query_modem
+		if (!info)
+			s->ident_failed = true;
+		else
+			snprintf(fresh->name + len, sizeof(fresh->name) - len, len ? " %s" : "%s", info);
+	} else if (cmd == &s->ident[2]) {
+		fresh->gsm = res == UDIALD_AT_OK && !udiald_parse_gcap(r->result_line, &caps) && (caps & UDIALD_GCAP_GSM);
+	} else if (info) {
+		// Some modems prefix the revision with +CGMR:
+		if (!strncmp(info, "+CGMR:", 6))
+			info += 6;
+		while (*info == ' ')
+			info++;
+		snprintf(fresh->firmware, sizeof(fresh->firmware), "%s", info);
+	}
+}
+
+/**
+ * Compare the identity reported by the modem now with the one used to
+ * connect (which might have come from the cache) and update the cache
+ * when anything changed, including when the firmware revision was not
+ * known yet.
+ */
+static void udiald_status_ident_done(struct udiald_at_cmd *cmd, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_status *s = cmd->priv;
+	struct udiald_state *state = s->state;
+	struct udiald_identity *id = &state->identity;
+
+	udiald_status_ident_cb(cmd, res, r);
+	if (s->ident_failed) {
+		udiald_log(LOG_INFO, "%s: Failed to check modem identity", state->modem.device_id);
+		return;
+	}
+	if (strcmp(s->fresh.name, id->name) || s->fresh.gsm != id->gsm) {
+		udiald_log(LOG_NOTICE, "%s: Modem identity changed: %s (was %s)", state->modem.device_id, s->fresh.name, id->name);
+		udiald_config_set(state, "modem_name", s->fresh.name);
+		udiald_config_revert(state, "modem_gsm");
+		if (s->fresh.gsm)
+			udiald_config_set(state, "modem_gsm", "1");
+		udiald_config_save(state);
+	} else if (!strcmp(s->fresh.firmware, id->firmware)) {
+		return;
+	}
+	memcpy(s->fresh.serial, id->serial, sizeof(id->serial));
+	*id = s->fresh;
+	udiald_idcache_store(state, id);
+}
+
+static void udiald_status_set_format_cb(struct udiald_at_cmd *cmd, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_status *s = cmd->priv;
+	if (res != UDIALD_AT_OK)
+		udiald_log(LOG_WARNING, "%s: Failed to set AT+COPS to long format\n", s->state->modem.device_id);
+}
+
+static void udiald_status_enable_urc_cb(struct udiald_at_cmd *cmd, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_status *s = cmd->priv;
+	if (res != UDIALD_AT_OK)
+		udiald_log(LOG_INFO, "%s: Modem does not support unsolicited registration reports (%s)", s->state->modem.device_id, cmd->command);
+}
+
+static void udiald_status_query_cb(struct udiald_at_cmd *cmd, enum udiald_atres res, struct udiald_tty_read *r) {
+	struct udiald_status *s = cmd->priv;
+	struct udiald_state *state = s->state;
+
+	// Schedule the next query, regardless of the result of this one
+	s->query_pending = false;
+	uloop_timeout_set(&s->timer, s->rssi_pushed ? UDIALD_STATUS_INTERVAL_PUSHED : UDIALD_STATUS_INTERVAL);
+	s->rssi_pushed = false;
+
+	if (res != UDIALD_AT_OK)
+		return;
+
+	struct udiald_cops cops;
+	for (size_t i = 0; i < r->lines; ++i) {
+		const char *line = r->raw_lines[i];
+		// +COPS: 0,0,"FONIC",2
+		if (!udiald_parse_cops(line, &cops) && cops.oper.len
+		&& (cops.oper.len != strlen(s->provider)
+		|| strncmp(cops.oper.s, s->provider, cops.oper.len))) {
+			snprintf(s->provider, sizeof(s->provider), "%.*s",
+				(int)cops.oper.len, cops.oper.s);
+			udiald_log(LOG_NOTICE, "%s: Provider is %s",
+				state->modem.device_id, s->provider);
 			udiald_config_revert(state, "provider");
-			udiald_config_set(state, "provider", cops);
-			strncpy(provider, cops, sizeof(provider) - 1);
+			udiald_config_set(state, "provider", s->provider);
+		// +CSQ: 14,99
+		} else if (!udiald_parse_csq(line, &s->csq)) {
+			udiald_config_revert(state, "rssi");
+			udiald_config_set_int(state, "rssi", s->csq.rssi);
+			if ((s->status % UDIALD_STATUS_LOGSTEPS) == 0)
+				udiald_log(LOG_NOTICE, "%s: RSSI is %d",
+					state->modem.device_id, s->csq.rssi);
 		}
+	}
+	udiald_config_save(state);
+}
 
-		if (csq && (csq = strtok_r(csq, " ,", &saveptr))
-		&& (csq = strtok_r(NULL, " ,", &saveptr))) {	// +CSQ: 14,99
-			// RSSI
-			udiald_config_revert(state, "rssi");
-			udiald_config_set(state, "rssi", csq);
-			if ((status % logsteps) == 0)
-				syslog(LOG_NOTICE, "%s: RSSI is %s",
-					state->modem.device_id, csq);
+// +CREG: <stat>[,<lac>,<ci>] or +CGREG: <stat>[,<lac>,<ci>]
+static void udiald_status_reg_urc(struct udiald_urc *urc, const char *line) {
+	struct udiald_status *s = urc->priv;
+	struct udiald_state *state = s->state;
+	bool ps = (urc == &s->cgreg_urc);
+	const char *key = ps ? "ps_registration" : "registration";
+	struct udiald_creg *reg = ps ? &s->cgreg : &s->creg;
+
+	if (udiald_parse_creg(line, true, reg)) {
+		udiald_log(LOG_WARNING, "%s: Ignoring malformed registration report: %s", state->modem.device_id, line);
+		return;
+	}
+	const char *stat = udiald_regstatus_str(reg->stat);
+
+	udiald_log(LOG_INFO, "%s: Registration status (%s): %s", state->modem.device_id, urc->prefix, stat);
+	udiald_config_revert(state, key);
+	udiald_config_set(state, key, stat);
+	udiald_config_save(state);
+
+	// The provider might have changed as well
+	udiald_status_query_now(s);
+}
+
+// ^RSSI:<rssi> (Huawei), same scale as the first +CSQ value
+static void udiald_status_rssi_urc(struct udiald_urc *urc, const char *line) {
+	struct udiald_status *s = urc->priv;
+	struct udiald_state *state = s->state;
+
+	if (udiald_parse_hw_rssi(line, &s->csq.rssi))
+		return;
+	udiald_log(LOG_DEBUG, "%s: RSSI changed to %d", state->modem.device_id, s->csq.rssi);
+	udiald_config_revert(state, "rssi");
+	udiald_config_set_int(state, "rssi", s->csq.rssi);
+	udiald_config_save(state);
+	s->rssi_pushed = true;
+}
+
+// ^MODE:<sys_mode>,<sys_submode> (Huawei)
+static void udiald_status_mode_urc(struct udiald_urc *urc, const char *line) {
+	struct udiald_status *s = urc->priv;
+	udiald_log(LOG_INFO, "%s: System mode changed (%s)", s->state->modem.device_id, line + strlen(urc->prefix));
+}
+
+static void udiald_status_ppp_timer_cb(struct uloop_timeout *t) {
+	struct udiald_status *s = container_of(t, struct udiald_status, ppp_timer);
+	struct udiald_state *state = s->state;
+	if (!udiald_tty_ppp_up(state)) {
+		uloop_timeout_set(t, UDIALD_STATUS_PPP_POLL);
+		return;
+	}
+	udiald_log(LOG_NOTICE, "%s: ppp link is up", state->modem.device_id);
+	udiald_timing_mark(state, UDIALD_PHASE_PPP_UP);
+	udiald_config_save(state);
+}
+
+static void udiald_status_timer_cb(struct uloop_timeout *t) {
+	struct udiald_status *s = container_of(t, struct udiald_status, timer);
+	s->status++;
+	// Handle a pending dump request (SIGUSR1)
+	udiald_util_dump_check();
+	udiald_status_query_now(s);
+}
+
+static void udiald_connect_status_mainloop(struct udiald_state *state) {
+	struct udiald_status s = {
+		.state = state,
+		.timer = { .cb = udiald_status_timer_cb },
+		.ppp_timer = { .cb = udiald_status_ppp_timer_cb },
+		.attach = {
+			.command = "AT+CGATT=1\r",
+			.timeout = 30000,
+			.cb = udiald_status_attach_cb,
+			.priv = &s,
+		},
+		.set_format = {
+			.command = "AT+COPS=3,0\r",
+			.timeout = 2500,
+			.cb = udiald_status_set_format_cb,
+			.priv = &s,
+		},
+		.enable_creg = {
+			.command = "AT+CREG=2\r",
+			.timeout = 2500,
+			.cb = udiald_status_enable_urc_cb,
+			.priv = &s,
+		},
+		.enable_cgreg = {
+			.command = "AT+CGREG=2\r",
+			.timeout = 2500,
+			.cb = udiald_status_enable_urc_cb,
+			.priv = &s,
+		},
+		.query = {
+			.command = "AT+COPS?;+CSQ\r",
+			.timeout = 2500,
+			.cb = udiald_status_query_cb,
+			.priv = &s,
+		},
+		.ident = {
+			{ .command = "AT+CGMI\r", .timeout = 2500, .cb = udiald_status_ident_cb, .priv = &s },
+			{ .command = "AT+CGMM\r", .timeout = 2500, .cb = udiald_status_ident_cb, .priv = &s },
+			{ .command = "AT+GCAP\r", .prefix = "+GCAP: ", .timeout = 2500, .cb = udiald_status_ident_cb, .priv = &s },
+			{ .command = "AT+CGMR\r", .timeout = 2500, .cb = udiald_status_ident_done, .priv = &s },
+		},
+		.creg_urc = { .prefix = "+CREG: ", .cb = udiald_status_reg_urc, .priv = &s },
+		.cgreg_urc = { .prefix = "+CGREG: ", .cb = udiald_status_reg_urc, .priv = &s },
+		.rssi_urc = { .prefix = "^RSSI:", .cb = udiald_status_rssi_urc, .priv = &s },
+		.mode_urc = { .prefix = "^MODE:", .cb = udiald_status_mode_urc, .priv = &s },
+	};
+
+	uloop_init();
+	udiald_at_init(&s.at, state->ctlfd);
+
+	// uloop_run forgets about uloop_end calls made before it started,
+	// so a signal caught between checking signaled and entering the
+	// loop would go unnoticed. The pipe stays readable instead.
+	int fds[2];
+	if (pipe(fds) == 0) {
+		for (size_t i = 0; i < 2; ++i) {
+			fcntl(fds[i], F_SETFL, O_NONBLOCK);
+			fcntl(fds[i], F_SETFD, FD_CLOEXEC);
 		}
-		ucix_save(state->uci, state->uciname);
+		s.signal_fd.fd = fds[0];
+		s.signal_fd.cb = udiald_status_signal_cb;
+		uloop_fd_add(&s.signal_fd, ULOOP_READ);
+		signal_pipe = fds[1];
+	} else {
+		udiald_log(LOG_WARNING, "Failed to create signal pipe: %s", strerror(errno));
 	}
-	syslog(LOG_NOTICE, "Received signal %d, disconnecting", signaled);
+
+	// Let the modem tell us about registration and signal changes,
+	// instead of only finding out at the next query.
+	udiald_tty_urc_register(&s.creg_urc);
+	udiald_tty_urc_register(&s.cgreg_urc);
+	udiald_tty_urc_register(&s.rssi_urc);
+	udiald_tty_urc_register(&s.mode_urc);
+	udiald_at_queue(&s.at, &s.enable_creg);
+	udiald_at_queue(&s.at, &s.enable_cgreg);
+
+	// Set reporting format for AT+COPS? to 0 (long alphanumeric
+	// format), for devices that default to reporting numeric
+	// identifiers only. "3" means to leave actual network selection
+	// parameters unchanged and only set the format.
+	udiald_at_queue(&s.at, &s.set_format);
+
+	udiald_config_set(state, "connected", "1");
+	udiald_config_save(state);
+
+	// Query provider and RSSI / BER right away, after that the
+	// query callback reschedules it periodically.
+	udiald_status_query_now(&s);
+
+	// Ask for the packet service attach, instead of leaving it to the
+	// dial command. This can take a while, so only after the first
+	// query, which it must not delay. The dialer waits for
+	// registration meanwhile.
+	if (state->is_gsm)
+		udiald_at_queue(&s.at, &s.attach);
+
+	// Check the identity used to connect in the background, to
+	// catch stale cache entries and learn the firmware revision
+	for (size_t i = 0; i < lengthof(s.ident); ++i)
+		udiald_at_queue(&s.at, &s.ident[i]);
+
+	uloop_timeout_set(&s.ppp_timer, UDIALD_STATUS_PPP_POLL);
+
+	// Run until a signal (SIGCHLD from pppd or a termination
+	// request) ends the loop
+	if (!signaled)
+		uloop_run();
+
+	udiald_at_done(&s.at);
+	uloop_timeout_cancel(&s.timer);
+	uloop_timeout_cancel(&s.ppp_timer);
+	if (s.signal_fd.registered) {
+		uloop_fd_delete(&s.signal_fd);
+		int fd = signal_pipe;
+		signal_pipe = -1;
+		close(fd);
+		close(s.signal_fd.fd);
+	}
+	udiald_tty_urc_unregister(&s.creg_urc);
+	udiald_tty_urc_unregister(&s.cgreg_urc);
+	udiald_tty_urc_unregister(&s.rssi_urc);
+	udiald_tty_urc_unregister(&s.mode_urc);
+	uloop_done();
+	udiald_log(LOG_NOTICE, "Received signal %d, disconnecting", signaled);
 }
 
 static void udiald_connect_finish(struct udiald_state *state) {
@@ -725,15 +1238,25 @@ static void udiald_connect_finish(struct udiald_state *state) {
 	udiald_config_revert(state, "connected");
 	udiald_config_revert(state, "provider");
 	udiald_config_revert(state, "rssi");
-
-	// Terminate active connection by hanging up and resetting
-	udiald_tty_put(state->ctlfd, "ATH;&F\r");
+	udiald_config_revert(state, "registration");
+	udiald_config_revert(state, "ps_registration");
+	udiald_config_revert(state, "pdp_apn");
+
+	// Terminate active connection by hanging up and resetting. The
+	// reset can make the modem register again, which slows down the
+	// next connect, so it can be turned off.
+	if (udiald_config_get_int(state, "udiald_hangup_reset", 1))
+		udiald_tty_put(state->ctlfd, "ATH;&F\r");
+	else
+		udiald_tty_put(state->ctlfd, "ATH\r");
 	int status;
 	if (waitpid(state->pppd, &status, WNOHANG) != state->pppd) {
 		kill(state->pppd, SIGTERM);
 		waitpid(state->pppd, &status, 0);
+		udiald_trace(UDIALD_TRACE_PPPD, state->pppd, status, NULL, 0);
 		udiald_exitcode(UDIALD_ESIGNALED, "Terminated by signal %i", signaled);
 	}
+	udiald_trace(UDIALD_TRACE_PPPD, state->pppd, status, NULL, 0);
 
 	if (WIFSIGNALED(status) || WEXITSTATUS(status) == 5) {
 		// pppd was termined externally, we won't treat this as an error
@@ -769,6 +1292,10 @@ int main(int argc, char *const argv[]) {
 
 	udiald_setup_uci(&state);
 
+	int max_response = udiald_config_get_int(&state, "udiald_max_response", UDIALD_TTY_MAX_RESPONSE);
+	if (max_response > 0)
+		udiald_tty_set_max_response(max_response);
+
 	/* Load additional profiles from uci */
 	udiald_modem_load_profiles(&state);
 
@@ -783,10 +1310,29 @@ int main(int argc, char *const argv[]) {
 	sigaction(SIGINT, &sa, NULL);
 	sigaction(SIGTERM, &sa, NULL);
 	sigaction(SIGHUP, &sa, NULL);
+	sa.sa_handler = udiald_dump_signal;
+	sigaction(SIGUSR1, &sa, NULL);
+
+	// Where to keep the trace of recent events, when dumped
+	char trace_path[PATH_MAX];
+	snprintf(trace_path, sizeof(trace_path), "%s" UDIALD_TRACE_FILE "%s%s", state.root ? state.root : "",
+		state.networkname, state.app == UDIALD_APP_DIAL ? "_dial" : "");
+	udiald_trace_init(trace_path, state.flags & UDIALD_FLAG_FORMAT && state.format == UDIALD_FORMAT_JSON);
+
+	// A transcript is only a debugging aid, so go on without one if
+	// it cannot be opened
+	if (state.transcript)
+		udiald_transcript_open(state.transcript, state.app == UDIALD_APP_DIAL ? UDIALD_TRANSCRIPT_DIAL : UDIALD_TRANSCRIPT_CONTROL);
 
 	// Dial only needs an active UCI context
-	if (state.app == UDIALD_APP_DIAL)
-		return udiald_dial_main(&state);
+	if (state.app == UDIALD_APP_DIAL) {
+		int ret = udiald_dial_main(&state);
+		udiald_cmdstats_dump(LOG_INFO);
+		udiald_cmdstats_save();
+		if (ret != UDIALD_OK)
+			udiald_trace_dump();
+		return ret;
+	}
 
 	if (state.app == UDIALD_APP_LIST_PROFILES)
 		return udiald_modem_list_profiles(&state);
@@ -796,7 +1342,7 @@ int main(int argc, char *const argv[]) {
 
 	if (state.app == UDIALD_APP_CONNECT && state.flags & UDIALD_FLAG_TESTSTATE) {
 		if (udiald_config_get_int(&state, "udiald_error", UDIALD_OK) == UDIALD_EUNLOCK) {
-			syslog(LOG_CRIT, "Aborting due to previous SIM unlocking failure. "
+			udiald_log(LOG_CRIT, "Aborting due to previous SIM unlocking failure. "
 			"Please check PIN and rescan device before reconnecting.");
 			exit(UDIALD_EUNLOCK);
 		}
@@ -814,18 +1360,21 @@ int main(int argc, char *const argv[]) {
 
 	if (state.app == UDIALD_APP_CONNECT) {
 		udiald_config_set(&state, "udiald_state", "init");
-		ucix_save(state.uci, state.uciname);
+		udiald_config_save(&state);
 	}
 
+	udiald_timing_start(&state);
+
 	udiald_select_modem(&state);
+	udiald_timing_mark(&state, UDIALD_PHASE_SELECT_MODEM);
 
 	udiald_open_control(&state);
+	udiald_timing_mark(&state, UDIALD_PHASE_OPEN_CONTROL);
 
 	udiald_modem_reset(&state);
+	udiald_timing_mark(&state, UDIALD_PHASE_RESET);
 
-	udiald_identify(&state);
-
-	udiald_check_sim(&state);
+	udiald_query_modem(&state);
 
 	if (state.app == UDIALD_APP_SCAN) {
 		udiald_exitcode(UDIALD_OK, NULL); // We are done here.
@@ -838,8 +1387,10 @@ int main(int argc, char *const argv[]) {
 		udiald_enter_puk(&state, argv[optind], argv[optind+1]);
 	}
 
-	if (state.sim_state == 1)
+	if (state.sim_state == 1) {
 		udiald_enter_pin(&state);
+		udiald_timing_mark(&state, UDIALD_PHASE_ENTER_PIN);
+	}
 
 	if (state.app == UDIALD_APP_UNLOCK)
 		udiald_exitcode(UDIALD_OK, NULL); // We are done here.
@@ -852,26 +1403,32 @@ int main(int argc, char *const argv[]) {
 	if (state.sim_state == 2)
 		udiald_exitcode(UDIALD_EUNLOCK, "SIM locked - need PUK");
 
-	udiald_check_caps(&state);
 /*
 	char b[512] = {0};
 	// verbose provider info
 	if (udiald_tty_put(state.ctlfd, "AT+CREG=2\r") < 1
 	|| udiald_tty_get(state.ctlfd, b, sizeof(b), 2500) != UDIALD_AT_OK) {
-		syslog(LOG_CRIT, "%s: failed to set verbose provider info (%s)", state.modem.device_id, b);
+		udiald_log(LOG_CRIT, "%s: failed to set verbose provider info (%s)", state.modem.device_id, b);
 	}
 */
 
+	// Set up the PDP context while the modem is still registering
+	if (state.is_gsm) {
+		udiald_set_context(&state);
+		udiald_timing_mark(&state, UDIALD_PHASE_CONTEXT);
+	}
+
 	// Setting network mode if GSM
 	if (state.is_gsm) {
 		udiald_set_mode(&state);
+		udiald_timing_mark(&state, UDIALD_PHASE_SET_MODE);
 	} else {
-		syslog(LOG_NOTICE, "%s: Skipped setting mode on non-GSM modem", state.modem.device_id);
+		udiald_log(LOG_NOTICE, "%s: Skipped setting mode on non-GSM modem", state.modem.device_id);
 	}
 
 	// Save state
 	udiald_config_set_int(&state, "pid", getpid());
-	ucix_save(state.uci, state.uciname);
+	udiald_config_save(&state);
 
 	// Block and unbind signals so they won't interfere
 	sa.sa_handler = udiald_catch_signal;
@@ -882,12 +1439,14 @@ int main(int argc, char *const argv[]) {
 
 	if (state.app == UDIALD_APP_CONNECT) {
 		udiald_config_set(&state, "udiald_state", "dial");
-		ucix_save(state.uci, state.uciname);
+		udiald_config_save(&state);
 	}
 
 	// Start pppd to dial
 	if (!(state.pppd = udiald_tty_pppd(&state)))
 		udiald_exitcode(UDIALD_EINTERNAL, "pppd: Failed to start");
+	udiald_trace(UDIALD_TRACE_PPPD, state.pppd, -1, NULL, 0);
+	udiald_timing_mark(&state, UDIALD_PHASE_PPPD);
 
 	udiald_connect_status_mainloop(&state);
 
@@ -9,16 +9,21 @@
 #define UDIALD_H_
 
 #include <libubox/list.h>
+#include <libubox/uloop.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <stdint.h>
 #include <errno.h>
 #include <glob.h>
+#include <syslog.h>
 #include <json/json.h>
 #include "ucix.h"
 
 #define UDIALD_FLAG_TESTSTATE	0x01
 #define UDIALD_FLAG_NOERRSTAT	0x02
 #define UDIALD_FLAG_SIGNALED	0x04
+#define UDIALD_FLAG_FORMAT	0x08 /* --format was given explicitly */
 
 #define lengthof(x) (sizeof(x) / sizeof(*x))
 
@@ -56,13 +61,23 @@ enum udiald_atres {
 	UDIALD_AT_BUSY,
 	UDIALD_AT_NOCARRIER,
 	UDIALD_AT_NOT_SUPPORTED,
+	UDIALD_AT_CMSERROR,
+	UDIALD_AT_NOANSWER,
+};
+
+enum udiald_config_flags {
+	UDIALD_CONFIG_NOBATCH = 1, /* Do not combine multiple AT commands on a single line */
 };
 
 struct udiald_config {
+	enum udiald_config_flags flags;
 	uint8_t ctlidx;		/* Index of control TTY from first TTY */
 	uint8_t datidx;		/* Index of data TTY from first TTY */
 	char *modecmd[UDIALD_NUM_MODES];	/* Commands to enter modes */
+	char *modequery;	/* Command to read the current mode, or NULL */
+	char *modecheck[UDIALD_NUM_MODES];	/* Response to modequery when in a mode (see udiald_parse_match) */
 	char *dialcmd; /* Dial command */
+	int pin_delay; /* Minimum time to wait after entering the PIN (in ms) */
 };
 
 enum udiald_profile_flags {
@@ -134,6 +149,24 @@ enum udiald_app {
 		UDIALD_APP_LIST_DEVICES, UDIALD_APP_PROBE,
 };
 
+/* Phases of the connection process, for timing */
+enum udiald_phase {
+	UDIALD_PHASE_SELECT_MODEM,
+	UDIALD_PHASE_OPEN_CONTROL,
+	UDIALD_PHASE_RESET,
+	UDIALD_PHASE_IDENTIFY,
+	UDIALD_PHASE_CHECK_SIM,
+	UDIALD_PHASE_ENTER_PIN,
+	UDIALD_PHASE_CONTEXT,	/* PDP context set up */
+	UDIALD_PHASE_SET_MODE,
+	UDIALD_PHASE_PPPD,	/* pppd started */
+	UDIALD_PHASE_ATTACH,	/* AT+CGATT=1 answered */
+	UDIALD_PHASE_DIAL,	/* Dial command sent (once per attempt) */
+	UDIALD_PHASE_CONNECT,	/* CONNECT received */
+	UDIALD_PHASE_PPP_UP,	/* ppp interface up */
+	UDIALD_NUM_PHASES /* This must always be the last entry. */
+};
+
 enum udiald_display_format {
 	/* Full details in JSON format */
 	UDIALD_FORMAT_JSON,
@@ -141,6 +174,14 @@ enum udiald_display_format {
 	UDIALD_FORMAT_ID,
 };
 
+/* What is known about a modem, see idcache.c */
+struct udiald_identity {
+	char serial[64];	/* USB serial number, empty when the device has none */
+	char firmware[64];	/* Firmware revision (+CGMR), empty when not known yet */
+	char name[512];		/* Manufacturer and model (+CGMI and +CGMM) */
+	bool gsm;		/* +GCAP reports GSM support */
+};
+
 /* Current umts state */
 struct udiald_state {
 	int ctlfd;
@@ -157,24 +198,266 @@ struct udiald_state {
 	struct list_head custom_profiles; /* Custom profiles loaded from uci */
 	enum udiald_app app;
 	enum udiald_display_format format;
+	char *transcript; /*< File to record all modem traffic to, if any */
+	const char *root; /*< Directory to use instead of / (for testing), or NULL */
+	const char *pppd_path; /*< pppd binary to run */
+	int64_t timing_start; /*< Start of the connection process (see timing.c) */
+	struct udiald_identity identity; /*< Identity of the selected modem */
+};
+
+/* A string inside a response line (not nul-terminated) */
+struct udiald_str {
+	const char *s;
+	size_t len;
+};
+
+/* Parsed +CSQ response */
+struct udiald_csq {
+	int rssi;	/* 0-31, or 99 when unknown */
+	int ber;	/* 0-7, or 99 when unknown */
+};
+
+/* Parsed +COPS response */
+struct udiald_cops {
+	int mode;
+	int format;
+	struct udiald_str oper;
+	int act;	/* Access technology */
+};
+
+enum udiald_sim_state {
+	UDIALD_SIM_READY,
+	UDIALD_SIM_PIN,
+	UDIALD_SIM_PUK,
+	UDIALD_SIM_OTHER,
+};
+
+/* Capabilities from +GCAP */
+enum udiald_gcap {
+	UDIALD_GCAP_GSM = 1,	/* +CGSM */
+	UDIALD_GCAP_CDMA = 2,	/* +CIS707 / +CIS707-A */
+	UDIALD_GCAP_MS = 4,	/* +MS */
+	UDIALD_GCAP_ES = 8,	/* +ES */
+	UDIALD_GCAP_DS = 16,	/* +DS */
+	UDIALD_GCAP_FCLASS = 32,	/* +FCLASS */
+};
+
+/* Registration status values from +CREG / +CGREG / +CEREG */
+enum udiald_regstatus {
+	UDIALD_REG_NOT_REGISTERED,
+	UDIALD_REG_HOME,
+	UDIALD_REG_SEARCHING,
+	UDIALD_REG_DENIED,
+	UDIALD_REG_UNKNOWN,
+	UDIALD_REG_ROAMING,
+};
+
+/* Parsed +CREG / +CGREG / +CEREG response */
+struct udiald_creg {
+	int n;		/* Reporting mode (only in query responses) */
+	int stat;	/* enum udiald_regstatus */
+	long lac;	/* Location area code */
+	long ci;	/* Cell id */
+	int act;	/* Access technology */
+};
+
+/* The pppd binary to run, unless overridden with --pppd */
+#define UDIALD_PPPD "/usr/sbin/pppd"
+
+/* Response times of AT commands, used to adapt timeouts (see cmdstats.c) */
+#define UDIALD_LATENCY_HISTORY "/var/state/udiald_latency"
+
+/* Identities of modems seen before (see idcache.c) */
+#define UDIALD_IDENTITY_CACHE "/var/state/udiald_identity"
+
+/* Maximum time to wait for a tty to accept written data (in ms) */
+#define UDIALD_TTY_WRITE_TIMEOUT 2500
+
+/* Instrumentation counters for tty I/O */
+struct udiald_tty_stats {
+	unsigned long bytes_written;
+	unsigned long writes;	/* write syscalls */
+	unsigned long bytes_read;
+	unsigned long reads;	/* read syscalls */
+};
+
+enum udiald_transcript_channel {
+	UDIALD_TRANSCRIPT_CONTROL,	/* Control tty (udiald itself) */
+	UDIALD_TRANSCRIPT_DIAL,		/* Data tty (the dialer started by pppd) */
+};
+
+enum udiald_transcript_dir {
+	UDIALD_TRANSCRIPT_TX,	/* Sent to the modem */
+	UDIALD_TRANSCRIPT_RX,	/* Received from the modem */
+};
+
+/* A single record read back from a transcript */
+struct udiald_transcript_record {
+	uint64_t timestamp;	/* CLOCK_MONOTONIC, in ms */
+	enum udiald_transcript_channel channel;
+	enum udiald_transcript_dir dir;
+	size_t len;
+	char data[UINT16_MAX];
+};
+
+/* Events in the in-memory trace (see trace.c) */
+enum udiald_trace_type {
+	UDIALD_TRACE_TX,	/* Data written, arg: fd */
+	UDIALD_TRACE_RX,	/* Data read, arg: fd */
+	UDIALD_TRACE_POLL,	/* Blocking poll returned, arg: (first) fd, val: result */
+	UDIALD_TRACE_WAKEUP,	/* Event loop woke up for a tty, arg: fd, val: events */
+	UDIALD_TRACE_PHASE,	/* Connection phase done, arg: enum udiald_phase, val: ms since start, data: name */
+	UDIALD_TRACE_UCI_SAVE,	/* uci state saved, data: package */
+	UDIALD_TRACE_PPPD,	/* pppd started or exited, arg: pid, val: wait status (-1 when started) */
+	UDIALD_TRACE_SIGNAL,	/* Signal received, arg: signal number */
+};
+
+/* Where the trace is written to (followed by the network name) */
+#define UDIALD_TRACE_FILE "/var/state/udiald_trace_"
+
+/* Source of time for all waits and timeouts (see clock.c) */
+struct udiald_clock {
+	int64_t (*now_us)(struct udiald_clock *c);
+	void (*sleep_ms)(struct udiald_clock *c, int ms);
+	int (*poll)(struct udiald_clock *c, struct pollfd *fds, nfds_t nfds, int timeout);
 };
 
+struct udiald_vclock;
+
+/* Called when a wait on a virtual clock would block. Returns the time
+ * of the next event (in us), or INT64_MAX if none. */
+typedef int64_t (*udiald_vclock_run)(struct udiald_vclock *vc);
+
+/* Virtual clock, which only advances when waiting */
+struct udiald_vclock {
+	struct udiald_clock clock;
+	int64_t now_us;
+	udiald_vclock_run run;
+	void *priv;		/* For use by the run callback */
+};
+
+/* Default for the maximum size of a single response (in bytes) */
+#define UDIALD_TTY_MAX_RESPONSE 16384
+
 /* Result struct for udiald_tty_get */
 struct udiald_tty_read {
 	// Number of lines read
 	size_t lines;
-	// Lines read
-	char *raw_lines[10];
-	// First line starting with the given result_prefix
+	// Lines read. These point into the receive buffer of the tty, so
+	// they are only valid until the next response is read from the
+	// same tty.
+	char **raw_lines;
+	// First line starting with the given result_prefix, set once the
+	// final result code was read
 	char *result_line;
+	// Milliseconds left until the deadline when the read finished
+	int remaining;
+	// Error number from +CME ERROR / +CMS ERROR, or -1
+	int cme_error;
+};
+
+struct udiald_tty_query;
+
+/* Called with the response to a query sent by udiald_tty_batch. The
+ * response is only valid during the call. */
+typedef void (*udiald_tty_query_cb)(struct udiald_tty_query *q, enum udiald_atres res, struct udiald_tty_read *r);
+
+/* A query command that can be batched with others */
+struct udiald_tty_query {
+	const char *command;	/* Command without "AT" and "\r", e.g. "+CGMI" */
+	const char *prefix;	/* Prefix of the information response, or NULL */
+	int timeout;		/* in ms */
+	udiald_tty_query_cb cb;
+	void *priv;
+};
+
+struct udiald_tty_dial;
+
+/* Called by udiald_tty_dial right after sending the dial command */
+typedef void (*udiald_tty_dial_cb)(struct udiald_tty_dial *dial);
+
+/* Parameters for udiald_tty_dial */
+struct udiald_tty_dial {
+	const char *name;	/* Name of the tty, for logging */
+	const char *dialcmd;	/* Dial command, including the \r */
+	int64_t deadline;	/* Give up at this time (see udiald_util_now_ms) */
+	int retry_delay;	/* Time between NO CARRIER and redialing (in ms) */
+	int reg_poll;		/* Interval to poll PS registration before dialing (in ms), 0 to dial blindly */
+	unsigned retries;	/* Redials after NO CARRIER while registered */
+	udiald_tty_dial_cb attempt;	/* Can be NULL */
+	void *priv;		/* For use by the callback */
+	/* Set by udiald_tty_dial */
+	unsigned attempts;	/* Number of times the dial command was sent */
+	int64_t wait;		/* Time spent waiting for registration (in ms) */
+	int regstat;		/* Last PS registration status (enum udiald_regstatus), or -1 */
+	bool no_cgreg, no_cereg;	/* +CGREG? / +CEREG? are not supported */
+};
+
+/* Parameters for udiald_tty_wait_ready */
+struct udiald_tty_ready {
+	const char *name;	/* Name of the tty, for logging */
+	int timeout;		/* Give up after this many ms */
+	int poll;		/* Interval between checks (in ms) */
+	bool registration;	/* Also wait for circuit switched registration */
+	bool nobatch;		/* Send the queries one by one */
+	/* Set by udiald_tty_wait_ready */
+	bool sim;		/* SIM reports READY */
+	bool registered;	/* Registration is settled (or not waited for) */
+	int elapsed;		/* Time spent waiting (in ms) */
+};
+
+struct udiald_urc;
+
+/* Called for every unsolicited result code matching urc->prefix. The
+ * line is only valid during the call. */
+typedef void (*udiald_urc_cb)(struct udiald_urc *urc, const char *line);
 
-	// Don't use, call udiald_tty_flatten_result instead
-	char flat_buf[512];
-	// Don't use, raw_lines above points into this buffer
-	char raw_buf[512];
+/* Handler for unsolicited result codes (e.g. "+CREG: " or "^RSSI:") */
+struct udiald_urc {
+	struct list_head h;
+	const char *prefix;	/* Handle lines starting with this prefix */
+	udiald_urc_cb cb;
+	void *priv;		/* For use by the callback */
+};
+
+struct udiald_at_cmd;
+
+/* Called when an asynchronous AT command completes. res and errno are
+ * set like the return value of udiald_tty_get, the response in r is
+ * only valid during the call. */
+typedef void (*udiald_at_cb)(struct udiald_at_cmd *cmd, enum udiald_atres res, struct udiald_tty_read *r);
+
+/* An AT command to be run by the asynchronous AT engine. These are
+ * owned by the caller and must stay valid until the callback is
+ * called, but can be queued again from inside the callback. */
+struct udiald_at_cmd {
+	struct list_head h;
+	const char *command;	/* Command to send, including the \r */
+	const char *prefix;	/* Look for a result line with this prefix (can be NULL) */
+	int timeout;		/* Timeout in ms */
+	udiald_at_cb cb;	/* Completion callback (can be NULL) */
+	void *priv;		/* For use by the callback */
+};
+
+/* Asynchronous AT engine, which runs queued commands one by one on a
+ * single tty from the uloop event loop. */
+struct udiald_at {
+	struct uloop_fd fd;
+	struct uloop_timeout timeout;
+	struct list_head queue;
+	struct udiald_at_cmd *current; /* The command awaiting a response */
+	struct udiald_tty_read r; /* The response collected so far */
 };
 
 extern int verbose;
+extern int udiald_log_mask;
+
+/* Log a message like syslog(3), but without formatting it (or even
+ * evaluating the arguments) when its priority is masked (see log.c) */
+#define udiald_log(priority, ...) do { \
+	if (udiald_log_mask & LOG_MASK(LOG_PRI(priority))) \
+		udiald_log_write(priority, __VA_ARGS__); \
+} while (0)
 
 const char* udiald_modem_modestr(enum udiald_mode mode);
 enum udiald_mode udiald_modem_modeval(const char *mode);
@@ -186,19 +469,92 @@ int udiald_modem_load_profiles(struct udiald_state *state);
 int udiald_tty_open(const char *tty);
 char* udiald_tty_calc(const char *basetty, uint8_t index, char buf[static 24]);
 int udiald_tty_cloexec(int fd);
+void udiald_tty_flush(int fd);
+void udiald_tty_set_max_response(size_t max);
+ssize_t udiald_tty_putv(int fd, struct iovec *iov, int iovcnt);
 int udiald_tty_put(int fd, const char *cmd);
+const struct udiald_tty_stats *udiald_tty_get_stats(void);
 const char *udiald_tty_flatten_result(struct udiald_tty_read *r);
+void udiald_tty_read_init(struct udiald_tty_read *r);
+enum udiald_atres udiald_tty_classify(const char *line, size_t len, int *error);
+ssize_t udiald_tty_fill(int fd);
+enum udiald_atres udiald_tty_parse(int fd, struct udiald_tty_read *r, const char *result_prefix);
 enum udiald_atres udiald_tty_get(int fd, struct udiald_tty_read *r, const char *result_prefix, int timeout);
+enum udiald_atres udiald_tty_get_until(int fd, struct udiald_tty_read *r, const char *result_prefix, int64_t deadline);
+enum udiald_atres udiald_tty_dial(int in, int out, struct udiald_tty_dial *dial, struct udiald_tty_read *r);
+void udiald_tty_batch(int fd, struct udiald_tty_query *q, size_t n, bool nobatch);
+bool udiald_tty_wait_ready(int fd, struct udiald_tty_ready *ready);
+void udiald_tty_drain(int fd);
+void udiald_tty_urc_register(struct udiald_urc *urc);
+void udiald_tty_urc_unregister(struct udiald_urc *urc);
 pid_t udiald_tty_pppd(struct udiald_state *state);
+bool udiald_tty_ppp_up(struct udiald_state *state);
+
+void udiald_at_init(struct udiald_at *at, int fd);
+void udiald_at_queue(struct udiald_at *at, struct udiald_at_cmd *cmd);
+void udiald_at_done(struct udiald_at *at);
+
+void udiald_clock_set(struct udiald_clock *c);
+int64_t udiald_clock_now_us(void);
+void udiald_clock_sleep_ms(int ms);
+int udiald_clock_poll(struct pollfd *fds, nfds_t nfds, int timeout);
+void udiald_vclock_init(struct udiald_vclock *vc, udiald_vclock_run run, void *priv);
+
+int udiald_transcript_open(const char *path, enum udiald_transcript_channel channel);
+void udiald_transcript_close(void);
+void udiald_transcript_recordv(enum udiald_transcript_dir dir, const struct iovec *data, int count);
+void udiald_transcript_record(enum udiald_transcript_dir dir, const void *data, size_t len);
+int udiald_transcript_read_header(int fd);
+int udiald_transcript_read(int fd, struct udiald_transcript_record *rec);
+
+void udiald_cmdstats_sent(const struct iovec *iov, int iovcnt);
+void udiald_cmdstats_done(enum udiald_atres res, int err);
+void udiald_cmdstats_dump(int priority);
+int udiald_cmdstats_timeout(int timeout);
+void udiald_cmdstats_load(const char *path, const char *profile);
+void udiald_cmdstats_save(void);
+
+void udiald_idcache_init(const struct udiald_state *state, struct udiald_identity *id);
+bool udiald_idcache_lookup(const struct udiald_state *state, struct udiald_identity *id);
+void udiald_idcache_store(const struct udiald_state *state, const struct udiald_identity *id);
+
+void udiald_tracev(enum udiald_trace_type type, int arg, int val, const struct iovec *iov, int iovcnt);
+void udiald_trace(enum udiald_trace_type type, int arg, int val, const void *data, size_t len);
+void udiald_trace_init(const char *path, bool json);
+int udiald_trace_dump(void);
+
+void udiald_timing_start(struct udiald_state *state);
+void udiald_timing_resume(struct udiald_state *state);
+void udiald_timing_mark(struct udiald_state *state, enum udiald_phase phase);
+struct json_object *udiald_timing_json(struct udiald_state *state);
+
+int udiald_parse_csq(const char *line, struct udiald_csq *csq);
+int udiald_parse_hw_rssi(const char *line, int *rssi);
+int udiald_parse_cops(const char *line, struct udiald_cops *cops);
+int udiald_parse_cpin(const char *line, enum udiald_sim_state *sim);
+int udiald_parse_gcap(const char *line, unsigned *caps);
+int udiald_parse_creg(const char *line, bool urc, struct udiald_creg *reg);
+int udiald_parse_match(const char *line, const char *pattern);
+const char *udiald_regstatus_str(int stat);
 
 int udiald_connect_main(struct udiald_state *state);
 int udiald_dial_main(struct udiald_state *state);
 void udiald_select_modem(struct udiald_state *state);
 
+void udiald_log_open(const char *ident, int option, int facility, int mask);
+void udiald_log_close(void);
+void udiald_log_setmask(int mask);
+void udiald_log_setlimit(bool enable);
+void udiald_log_write(int priority, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
 int udiald_util_checked_glob(const char *pattern, int flags, glob_t *pglob, const char *activity);
 int udiald_util_parse_hex_word(const char *hex, uint16_t *res);
 int udiald_util_read_hex_word(const char *path, uint16_t *res);
 void udiald_util_read_symlink_basename(const char *path, char *res, size_t size);
 struct json_object *udiald_util_sprintf_json_string(const char *fmt, ...);
+int64_t udiald_util_now_ms(void);
+void udiald_util_redact(char *data, size_t len);
+void udiald_util_dump_request(void);
+bool udiald_util_dump_check(void);
 
 #endif /* UDIALD_H_ */
@@ -30,6 +30,8 @@
 #include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <time.h>
+#include <signal.h>
 
 /**
  * A version of glob that checks the return value and in case of error,
@@ -47,10 +49,10 @@ int udiald_util_checked_glob(const char *pattern, int flags, glob_t *pglob, cons
 	} else if (e == GLOB_NOMATCH) {
 		return UDIALD_ENODEV;
 	} else if (errno) {
-		syslog(LOG_CRIT, "Glob error while %s: %s", activity, strerror(errno));
+		udiald_log(LOG_CRIT, "Glob error while %s: %s", activity, strerror(errno));
 		return UDIALD_EINTERNAL;
 	} else {
-		syslog(LOG_CRIT, "Unknown glob error while %s", activity);
+		udiald_log(LOG_CRIT, "Unknown glob error while %s", activity);
 		return UDIALD_EINTERNAL;
 	}
 }
@@ -63,7 +65,7 @@ int udiald_util_parse_hex_word(const char *hex, uint16_t *res) {
 	char *end;
 	*res = strtoul(hex, &end, 16);
 	if (*end != '\0') {
-		syslog(LOG_DEBUG, "Failed to convert hex word (read: \"%s\")", hex);
+		udiald_log(LOG_DEBUG, "Failed to convert hex word (read: \"%s\")", hex);
 		return UDIALD_EINVAL;
 	}
 	return UDIALD_OK;
@@ -82,7 +84,7 @@ int udiald_util_read_hex_word(const char *path, uint16_t *res) {
 
 	int fd = open(path, O_RDONLY);
 	if (fd == -1) {
-		syslog(LOG_DEBUG, "%s: Failed to open: %s", path, strerror(errno));
+		udiald_log(LOG_DEBUG, "%s: Failed to open: %s", path, strerror(errno));
 		errno = 0;
 		return UDIALD_EINVAL;
 	}
@@ -90,7 +92,7 @@ int udiald_util_read_hex_word(const char *path, uint16_t *res) {
 	int n = read(fd, buf, hex_bytes);
 	close(fd);
 	if (n != hex_bytes) {
-		syslog(LOG_DEBUG, "%s: Failed to read %d bytes (got %d): %s", path, hex_bytes, n, strerror(errno));
+		udiald_log(LOG_DEBUG, "%s: Failed to read %d bytes (got %d): %s", path, hex_bytes, n, strerror(errno));
 		errno = 0;
 		return UDIALD_EINVAL;
 	}
@@ -120,7 +122,7 @@ struct json_object *udiald_util_sprintf_json_string(const char *fmt, ...) {
 
 	va_start(ap, fmt);
 	if (vasprintf(&str, fmt, ap) < 0) {
-		syslog(LOG_ERR, "Failed to sprintf (format: %s)", fmt);
+		udiald_log(LOG_ERR, "Failed to sprintf (format: %s)", fmt);
 		return NULL;
 	}
 	va_end(ap);
@@ -129,3 +131,52 @@ struct json_object *udiald_util_sprintf_json_string(const char *fmt, ...) {
 	free(str);
 	return obj;
 }
+
+/**
+ * Returns the current CLOCK_MONOTONIC time in milliseconds. Use this
+ * for deadlines and measuring durations, since it does not jump when
+ * the wall clock is changed (e.g. by ntpd after boot). When a virtual
+ * clock is installed (see clock.c), this returns its time instead.
+ */
+int64_t udiald_util_now_ms(void) {
+	return udiald_clock_now_us() / 1000;
+}
+
+/**
+ * Mask the arguments of PIN commands (e.g. AT+CPIN="1234") in data sent
+ * to the modem, so PINs and PUKs do not end up in traces or
+ * transcripts. This is safe to call from a signal handler.
+ */
+void udiald_util_redact(char *data, size_t len) {
+	bool mask = false;
+	for (size_t i = 0; i < len; ++i) {
+		if (data[i] == '\r' || data[i] == ';')
+			mask = false;
+		else if (mask && data[i] != '"' && data[i] != ',')
+			data[i] = '*';
+		else if (data[i] == '=' && i >= 3 && !strncmp(data + i - 3, "PIN", 3))
+			mask = true;
+	}
+}
+
+static volatile sig_atomic_t dump_requested;
+
+/**
+ * Request a dump of the AT command statistics and the trace at the
+ * next opportunity. This is safe to call from a signal handler.
+ */
+void udiald_util_dump_request(void) {
+	dump_requested = 1;
+}
+
+/**
+ * Do the dump if it was requested. Returns whether it was.
+ */
+bool udiald_util_dump_check(void) {
+	if (!dump_requested)
+		return false;
+	dump_requested = 0;
+	udiald_cmdstats_dump(LOG_NOTICE);
+	udiald_trace_dump();
+	return true;
+}
@@ -0,0 +1,100 @@
+#!/bin/sh
+# Measure the time udiald takes from start until the modem answers
+# CONNECT, using the modem simulator and a stub pppd.
+#
+# Usage: tools/connect-bench.sh [-n runs] [-m personality] [-- modemsim options]
+#
+# Every run creates a scratch root directory with a fake sysfs entry for
+# the simulated modem, device nodes pointing to the simulator's ttys and
+# a minimal uci config, and runs "udiald --root" on it. Build udiald and
+# the tools first (make all tools).
+
+set -e
+
+runs=10
+personality=huawei
+while getopts n:m: opt; do
+	case $opt in
+		n) runs=$OPTARG ;;
+		m) personality=$OPTARG ;;
+		*) sed -n '4p' "$0" >&2; exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+[ "$1" = "--" ] && shift
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+udiald=$top/udiald
+modemsim=$top/tools/udiald-modemsim
+pppd=$top/tools/pppd-stub
+
+# USB id, number of ttys, control and data tty index of the built-in
+# profile each personality is meant to match
+case $personality in
+	huawei)   id=12d1:1506; ttys=3; ctl=2; dat=0 ;;
+	zte)      id=19d2:0055; ttys=3; ctl=2; dat=0 ;;
+	ericsson) id=0bdb:1900; ttys=2; ctl=1; dat=0 ;;
+	alcatel)  id=1bbb:0000; ttys=3; ctl=1; dat=2 ;;
+	*) echo "Unknown personality: $personality" >&2; exit 1 ;;
+esac
+
+# Create the scratch root in $1
+setup_root() {
+	root=$1
+	mkdir -p "$root/dev" "$root/etc/config" "$root/var/state"
+	"$top/tools/sysfs-fixture.sh" -i $id -t $ttys "$root"
+	ln -s "$root/sim1" "$root/dev/ttyUSB$ctl"
+	ln -s "$root/sim0" "$root/dev/ttyUSB$dat"
+	cat > "$root/etc/config/network" <<-UCI
+	config interface wan
+		option udiald_apn internet
+	UCI
+}
+
+results=$(mktemp)
+trap 'rm -f "$results"' EXIT
+
+run=1
+while [ $run -le "$runs" ]; do
+	root=$(mktemp -d)
+	setup_root "$root"
+
+	"$modemsim" -m "$personality" -l "$root/sim" "$@" > /dev/null &
+	sim=$!
+	while [ ! -e "$root/sim1" ]; do
+		kill -0 $sim || exit 1
+		sleep 0.01
+	done
+
+	start=$(date +%s%N)
+	UDIALD_LINKUP=$root/linkup "$udiald" -q -q --root "$root" --pppd "$pppd" -D 1-1 > /dev/null &
+	pid=$!
+
+	# Wait for the link to come up, or for udiald to give up
+	while [ ! -s "$root/linkup" ] && kill -0 $pid 2>/dev/null; do
+		sleep 0.01
+	done
+	if [ -s "$root/linkup" ]; then
+		end=$(cat "$root/linkup")
+		echo $(((end - start) / 1000000)) >> "$results"
+		echo "run $run: $(((end - start) / 1000000)) ms"
+	else
+		echo "run $run: failed" >&2
+	fi
+
+	kill $pid 2>/dev/null || true
+	wait $pid 2>/dev/null || true
+	kill $sim
+	wait $sim 2>/dev/null || true
+	rm -rf "$root"
+	run=$((run + 1))
+done
+
+sort -n "$results" | awk '
+	{ v[NR] = $1; sum += $1 }
+	END {
+		if (!NR) { print "No successful runs"; exit 1 }
+		p90 = v[int((NR - 1) * 0.9) + 1]
+		printf "%d runs: min %d ms, median %d ms, p90 %d ms, max %d ms, mean %.1f ms\n",
+			NR, v[1], v[int((NR + 1) / 2)], p90, v[NR], sum / NR
+	}'
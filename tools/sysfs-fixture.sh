@@ -0,0 +1,129 @@
+#!/bin/sh
+# Create a fake sysfs tree with USB hubs, other USB devices and modems,
+# for testing and benchmarking device discovery (udiald --root).
+#
+# Usage: tools/sysfs-fixture.sh [-d depth] [-f fanout] [-m modems] [-i vid:pid] [-t ttys] [-r driver] root
+#
+# Below the root hub, this creates depth levels of hubs with fanout
+# ports each. Every port of the lowest level has a device: the last
+# ones are modems (with ttys numbered from ttyUSB0), all others are
+# USB storage devices. Like in the real sysfs, the devices are nested
+# below the hub they are connected to in /sys/devices, and
+# /sys/bus/usb/devices has a symlink for every device and interface.
+#
+# Without options, this creates a single modem with device id 1-1.
+
+set -e
+
+depth=0
+fanout=1
+modems=1
+id=12d1:1506
+ttys=3
+driver=option
+while getopts d:f:m:i:t:r: opt; do
+	case $opt in
+		d) depth=$OPTARG ;;
+		f) fanout=$OPTARG ;;
+		m) modems=$OPTARG ;;
+		i) id=$OPTARG ;;
+		t) ttys=$OPTARG ;;
+		r) driver=$OPTARG ;;
+		*) sed -n '5p' "$0" >&2; exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+if [ $# -ne 1 ]; then
+	sed -n '5p' "$0" >&2
+	exit 1
+fi
+
+root=$1
+sys=$root/sys
+bus=$sys/bus/usb/devices
+drivers=$sys/bus/usb/drivers
+usb1=$sys/devices/pci0000:00/0000:00:14.0/usb1
+mkdir -p "$bus" "$drivers/hub" "$drivers/usb-storage" "$drivers/$driver" "$drivers/usb"
+
+# Set $path to the path of device $1 (e.g. 1-3.2) below /sys/devices
+devpath() {
+	first=${1%%.*}
+	path=$usb1/$first
+	cur=$first
+	rest=${1#"$first"}
+	while [ -n "$rest" ]; do
+		rest=${rest#.}
+		seg=${rest%%.*}
+		cur=$cur.$seg
+		path=$path/$cur
+		rest=${rest#"$seg"}
+	done
+}
+
+# Create device $1 at path $2 with USB id $3:$4, device class $5 and
+# an interface bound to driver $6. The interface is named after the
+# device, unless another name is given in $7.
+mkdevice() {
+	intf=${7:-$1}:1.0
+	mkdir -p "$2/power" "$2/ep_00" "$2/$intf/power" "$2/$intf/ep_81"
+	echo "$3" > "$2/idVendor"
+	echo "$4" > "$2/idProduct"
+	echo "$5" > "$2/bDeviceClass"
+	ln -s "$drivers/usb" "$2/driver"
+	ln -s "$drivers/$6" "$2/$intf/driver"
+	ln -s "$2" "$bus/$1"
+	ln -s "$2/$intf" "$bus/$intf"
+}
+
+# Root hub
+mkdevice usb1 "$usb1" 1d6b 0002 09 hub 1-0
+
+# Hubs, level by level
+level=0
+ports=""
+i=1
+while [ $i -le "$fanout" ]; do
+	ports="$ports 1-$i"
+	i=$((i + 1))
+done
+while [ $level -lt "$depth" ]; do
+	next=""
+	for port in $ports; do
+		devpath "$port"
+		mkdevice "$port" "$path" 05e3 0608 09 hub
+		i=1
+		while [ $i -le "$fanout" ]; do
+			next="$next $port.$i"
+			i=$((i + 1))
+		done
+	done
+	ports=$next
+	level=$((level + 1))
+done
+
+# Devices on the lowest level, the modems last
+total=$(echo $ports | wc -w)
+n=0
+tty=0
+for port in $ports; do
+	n=$((n + 1))
+	devpath "$port"
+	if [ $n -le $((total - modems)) ]; then
+		mkdevice "$port" "$path" 0781 5567 00 usb-storage
+		continue
+	fi
+
+	mkdevice "$port" "$path" "${id%:*}" "${id#*:}" 00 "$driver"
+	i=0
+	while [ $i -lt "$ttys" ]; do
+		intf=$path/$port:1.$i
+		if [ $i -gt 0 ]; then
+			mkdir -p "$intf/power" "$intf/ep_8$i"
+			ln -s "$drivers/$driver" "$intf/driver"
+			ln -s "$intf" "$bus/$port:1.$i"
+		fi
+		mkdir -p "$intf/ttyUSB$tty/power"
+		tty=$((tty + 1))
+		i=$((i + 1))
+	done
+done
@@ -0,0 +1,596 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Simulated 3G modem, for testing and benchmarking udiald without real
+ * hardware.
+ *
+ * A control tty and a data tty are created as pseudo terminals, which
+ * answer a subset of the AT command set like the modems supported by
+ * the profiles in src/deviceconfig.h do. Every response is sent after a
+ * configurable delay, network registration takes a configurable time
+ * (dialing before that gives NO CARRIER) and errors can be injected for
+ * any command.
+ *
+ * The names of the slave ttys are printed on startup. With -l, symlinks
+ * to them are created as well.
+ */
+
+#define _GNU_SOURCE // Get cfmakeraw
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <termios.h>
+#include <strings.h>
+#include "udiald.h"
+
+int verbose = 0;
+
+enum sim_personality {
+	SIM_GENERIC,
+	SIM_HUAWEI,	/* AT^SYSCFG, ^RSSI / ^MODE reports */
+	SIM_ZTE,	/* AT+ZSNT */
+	SIM_ERICSSON,	/* AT+CFUN modes */
+	SIM_ALCATEL,	/* SIM is busy for a while after PIN entry */
+};
+
+static const struct {
+	const char *name;
+	const char *manufacturer;
+	const char *model;
+} personalities[] = {
+	[SIM_GENERIC] = {"generic", "Generic", "Modem"},
+	[SIM_HUAWEI] = {"huawei", "huawei", "E367"},
+	[SIM_ZTE] = {"zte", "ZTE CORPORATION", "K3520-Z"},
+	[SIM_ERICSSON] = {"ericsson", "Ericsson", "F3705G"},
+	[SIM_ALCATEL] = {"alcatel", "Alcatel", "X060S"},
+};
+
+// An injected error: commands starting with prefix fail
+struct sim_error {
+	const char *prefix;
+	int cme;	/* +CME ERROR code, or -1 for plain ERROR */
+	int count;	/* Number of times to fail, 0 for always */
+};
+
+static struct {
+	enum sim_personality personality;
+	int delay;		/* Response delay in ms */
+	int register_delay;	/* Time until registered in ms */
+	int urc_interval;	/* Interval of unsolicited reports in ms */
+	int nocarrier;		/* Number of dial attempts to fail */
+	int busy_after_pin;	/* Time the SIM is busy after PIN entry */
+	bool nobatch;		/* Reject multiple commands on a line */
+	const char *pin;	/* PIN the SIM wants, if any */
+	struct sim_error errors[16];
+	size_t nerrors;
+} cfg = {
+	.delay = 20,
+	.register_delay = 0,
+	.urc_interval = 0,
+	.busy_after_pin = 3000,
+};
+
+static struct {
+	int64_t start;
+	bool unlocked;
+	int64_t pin_entered;
+	int creg, cgreg;	/* Unsolicited report modes */
+	int mode;		/* Last mode set (personality specific) */
+	char apn[64];
+	int64_t next_urc;
+} sim;
+
+struct sim_tty {
+	const char *name;
+	int master;
+	bool echo;
+	bool online;	/* In data mode after CONNECT */
+	char in[512];
+	size_t inlen;
+	char out[4096];	/* Pending response */
+	size_t outlen;
+	int64_t due;	/* When to send the pending response */
+};
+
+static struct sim_tty ttys[2] = {
+	{.name = "control", .echo = true},
+	{.name = "data", .echo = true},
+};
+
+static volatile sig_atomic_t done;
+
+static void sim_signal(int sig) {
+	done = 1;
+}
+
+static void sim_out(struct sim_tty *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void sim_out(struct sim_tty *t, const char *fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	int len = vsnprintf(t->out + t->outlen, sizeof(t->out) - t->outlen, fmt, ap);
+	va_end(ap);
+	if (len > 0)
+		t->outlen += len;
+	if (t->outlen > sizeof(t->out) - 1)
+		t->outlen = sizeof(t->out) - 1;
+}
+
+// Add an information response line
+static void sim_info(struct sim_tty *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void sim_info(struct sim_tty *t, const char *fmt, ...) {
+	char line[256];
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	sim_out(t, "\r\n%s\r\n", line);
+}
+
+static bool sim_registered(void) {
+	return udiald_util_now_ms() - sim.start >= cfg.register_delay;
+}
+
+static bool sim_busy(void) {
+	return cfg.personality == SIM_ALCATEL && sim.pin_entered
+		&& udiald_util_now_ms() - sim.pin_entered < cfg.busy_after_pin;
+}
+
+// Returns an injected error for cmd, or NULL
+static struct sim_error *sim_injected(const char *cmd) {
+	for (size_t i = 0; i < cfg.nerrors; ++i) {
+		struct sim_error *e = &cfg.errors[i];
+		if (strncasecmp(cmd, e->prefix, strlen(e->prefix)))
+			continue;
+		if (e->count < 0)
+			continue;
+		if (e->count > 0 && --e->count == 0)
+			e->count = -1;
+		return e;
+	}
+	return NULL;
+}
+
+// Run a single command (without the AT prefix). Returns the final
+// result code to send, or NULL when the final result was added already.
+static const char *sim_command(struct sim_tty *t, const char *cmd) {
+	const char *manufacturer = personalities[cfg.personality].manufacturer;
+	const char *model = personalities[cfg.personality].model;
+	int n;
+
+	struct sim_error *e = sim_injected(cmd);
+	if (e && e->cme >= 0) {
+		sim_info(t, "+CME ERROR: %d", e->cme);
+		return NULL;
+	} else if (e) {
+		return "ERROR";
+	}
+
+	if (!*cmd || !strcasecmp(cmd, "H") || !strcasecmp(cmd, "Z") || !strcasecmp(cmd, "&F"))
+		return "OK";
+	if (!strcasecmp(cmd, "E0") || !strcasecmp(cmd, "E1")) {
+		t->echo = (cmd[1] == '1');
+		return "OK";
+	}
+	if (!strcasecmp(cmd, "I")) {
+		sim_info(t, "Manufacturer: %s", manufacturer);
+		sim_info(t, "Model: %s", model);
+		sim_info(t, "IMEI: 000000000000000");
+		return "OK";
+	}
+	if (!strcasecmp(cmd, "+CGMI") || !strcasecmp(cmd, "+GMI")) {
+		sim_info(t, "%s", manufacturer);
+		return "OK";
+	}
+	if (!strcasecmp(cmd, "+CGMM") || !strcasecmp(cmd, "+GMM")) {
+		sim_info(t, "%s", model);
+		return "OK";
+	}
+	if (!strcasecmp(cmd, "+GCAP")) {
+		sim_info(t, "+GCAP: +CGSM,+DS,+ES");
+		return "OK";
+	}
+
+	if (!strcasecmp(cmd, "+CPIN?")) {
+		if (sim_busy()) {
+			sim_info(t, "+CME ERROR: 14");
+			return NULL;
+		}
+		sim_info(t, "+CPIN: %s", (cfg.pin && !sim.unlocked) ? "SIM PIN" : "READY");
+		return "OK";
+	}
+	if (!strncasecmp(cmd, "+CPIN=", 6)) {
+		char pin[16] = "";
+		sscanf(cmd + 6, "\"%15[^\"]\"", pin);
+		if (!cfg.pin || sim.unlocked) {
+			sim_info(t, "+CME ERROR: 3");
+			return NULL;
+		}
+		if (strcmp(pin, cfg.pin)) {
+			sim_info(t, "+CME ERROR: 16");
+			return NULL;
+		}
+		sim.unlocked = true;
+		sim.pin_entered = udiald_util_now_ms();
+		return "OK";
+	}
+
+	// Everything below needs the SIM
+	if (cfg.pin && !sim.unlocked) {
+		sim_info(t, "+CME ERROR: 11");
+		return NULL;
+	}
+	if (sim_busy()) {
+		sim_info(t, "+CME ERROR: 14");
+		return NULL;
+	}
+
+	if (!strcasecmp(cmd, "+CSQ")) {
+		sim_info(t, "+CSQ: %d,99", sim_registered() ? 17 : 99);
+		return "OK";
+	}
+	if (!strcasecmp(cmd, "+COPS?")) {
+		if (sim_registered())
+			sim_info(t, "+COPS: 0,0,\"Simulated Network\",2");
+		else
+			sim_info(t, "+COPS: 0");
+		return "OK";
+	}
+	if (!strncasecmp(cmd, "+COPS=", 6))
+		return "OK";
+	if (sscanf(cmd, "+CREG=%d", &n) == 1 || sscanf(cmd, "+creg=%d", &n) == 1) {
+		sim.creg = n;
+		return "OK";
+	}
+	if (sscanf(cmd, "+CGREG=%d", &n) == 1 || sscanf(cmd, "+cgreg=%d", &n) == 1) {
+		sim.cgreg = n;
+		return "OK";
+	}
+	if (!strcasecmp(cmd, "+CREG?") || !strcasecmp(cmd, "+CGREG?") || !strcasecmp(cmd, "+CEREG?")) {
+		char name[8];
+		snprintf(name, sizeof(name), "%.*s", (int)(strlen(cmd) - 1), cmd);
+		sim_info(t, "%s: %d,%d", name, !strcasecmp(cmd, "+CGREG?") ? sim.cgreg : sim.creg, sim_registered() ? 1 : 2);
+		return "OK";
+	}
+	if (!strncasecmp(cmd, "+CGDCONT=", 9)) {
+		sscanf(cmd + 9, "%*d,\"%*[^\"]\",\"%63[^\"]\"", sim.apn);
+		return "OK";
+	}
+	if (!strcasecmp(cmd, "+CGDCONT?")) {
+		sim_info(t, "+CGDCONT: 1,\"IP\",\"%s\",\"\",0,0", sim.apn);
+		return "OK";
+	}
+	if (!strcasecmp(cmd, "+CGATT?")) {
+		sim_info(t, "+CGATT: %d", sim_registered());
+		return "OK";
+	}
+	if (!strcasecmp(cmd, "+CGATT=1"))
+		return sim_registered() ? "OK" : "ERROR";
+
+	if (toupper(cmd[0]) == 'D') {
+		if (cfg.nocarrier > 0 || !sim_registered()) {
+			if (cfg.nocarrier > 0)
+				cfg.nocarrier--;
+			return "NO CARRIER";
+		}
+		t->online = true;
+		return "CONNECT";
+	}
+
+	switch (cfg.personality) {
+		case SIM_HUAWEI:
+			if (sscanf(cmd, "^SYSCFG=%d", &n) == 1) {
+				sim.mode = n;
+				return "OK";
+			}
+			if (!strcasecmp(cmd, "^SYSCFG?")) {
+				sim_info(t, "^SYSCFG:%d,0,3FFFFFFF,1,2", sim.mode ? sim.mode : 2);
+				return "OK";
+			}
+			break;
+		case SIM_ZTE:
+			if (sscanf(cmd, "+ZSNT=%d", &n) == 1) {
+				sim.mode = n;
+				return "OK";
+			}
+			if (!strcasecmp(cmd, "+ZSNT?")) {
+				sim_info(t, "+ZSNT: %d,0,0", sim.mode);
+				return "OK";
+			}
+			break;
+		case SIM_ERICSSON:
+			if (sscanf(cmd, "+CFUN=%d", &n) == 1) {
+				sim.mode = n;
+				return "OK";
+			}
+			if (!strcasecmp(cmd, "+CFUN?")) {
+				sim_info(t, "+CFUN: %d", sim.mode ? sim.mode : 1);
+				return "OK";
+			}
+			break;
+		default:
+			break;
+	}
+	return "ERROR";
+}
+
+// Handle a complete command line
+static void sim_line(struct sim_tty *t, char *line) {
+	if (t->echo)
+		sim_out(t, "%s\r", line);
+	if (verbose)
+		fprintf(stderr, "%s < %s\n", t->name, line);
+
+	if (strncasecmp(line, "AT", 2)) {
+		if (*line)
+			sim_info(t, "ERROR");
+		t->due = udiald_util_now_ms() + cfg.delay;
+		return;
+	}
+	line += 2;
+
+	if (cfg.nobatch && strchr(line, ';')) {
+		sim_info(t, "ERROR");
+		t->due = udiald_util_now_ms() + cfg.delay;
+		return;
+	}
+
+	// Extended commands can be combined with ';', just run them in
+	// order and stop at the first one that fails.
+	const char *res = "OK";
+	char *saveptr;
+	char *cmd = strtok_r(line, ";", &saveptr);
+	do {
+		res = sim_command(t, cmd ? cmd : "");
+		if (!res || strcmp(res, "OK"))
+			break;
+	} while (cmd && (cmd = strtok_r(NULL, ";", &saveptr)));
+
+	if (res)
+		sim_info(t, "%s", res);
+	t->due = udiald_util_now_ms() + cfg.delay;
+}
+
+static void sim_read(struct sim_tty *t) {
+	ssize_t n = read(t->master, t->in + t->inlen, sizeof(t->in) - t->inlen - 1);
+	if (n <= 0)
+		return;
+
+	// In data mode, everything is passed to the (non-existing)
+	// network. Since there is no real carrier to lose, an AT command
+	// (e.g. from the next dial attempt) ends data mode.
+	if (t->online) {
+		if (n < 2 || strncasecmp(t->in + t->inlen, "AT", 2))
+			return;
+		t->online = false;
+		t->echo = true;
+	}
+
+	t->inlen += n;
+	t->in[t->inlen] = '\0';
+	char *end;
+	while ((end = strpbrk(t->in, "\r\n"))) {
+		*end = '\0';
+		if (end != t->in)
+			sim_line(t, t->in);
+		t->inlen -= end + 1 - t->in;
+		memmove(t->in, end + 1, t->inlen + 1);
+	}
+	// Drop overlong lines
+	if (t->inlen == sizeof(t->in) - 1)
+		t->inlen = 0;
+}
+
+// Send pending responses that are due and return the time until the
+// next event (in ms, -1 for none).
+static int sim_flush(void) {
+	int64_t now = udiald_util_now_ms();
+	int64_t next = -1;
+
+	for (size_t i = 0; i < lengthof(ttys); ++i) {
+		struct sim_tty *t = &ttys[i];
+		if (!t->outlen)
+			continue;
+		if (t->due > now) {
+			if (next < 0 || t->due < next)
+				next = t->due;
+			continue;
+		}
+		if (verbose)
+			fprintf(stderr, "%s > %.*s\n", t->name, (int)t->outlen, t->out);
+		if (write(t->master, t->out, t->outlen) < 0)
+			perror("write");
+		t->outlen = 0;
+	}
+
+	// Unsolicited reports go to the control tty, unless it is busy
+	// with a command
+	struct sim_tty *ctl = &ttys[0];
+	if (cfg.urc_interval && !ctl->outlen && now >= sim.next_urc) {
+		int stat = sim_registered() ? 1 : 2;
+		char urcs[128] = "";
+		if (sim.creg)
+			snprintf(urcs, sizeof(urcs), "\r\n+CREG: %d\r\n", stat);
+		if (sim.cgreg)
+			snprintf(urcs + strlen(urcs), sizeof(urcs) - strlen(urcs), "\r\n+CGREG: %d\r\n", stat);
+		if (cfg.personality == SIM_HUAWEI)
+			snprintf(urcs + strlen(urcs), sizeof(urcs) - strlen(urcs), "\r\n^RSSI:%d\r\n", stat == 1 ? 17 : 99);
+		if (*urcs && write(ctl->master, urcs, strlen(urcs)) < 0)
+			perror("write");
+		sim.next_urc = now + cfg.urc_interval;
+	}
+	if (cfg.urc_interval && (next < 0 || sim.next_urc < next))
+		next = sim.next_urc;
+
+	return next < 0 ? -1 : (next > now ? next - now : 0);
+}
+
+static void usage(const char *app) {
+	fprintf(stderr,
+		"Usage: %s [options]\n\n"
+		"	-m <personality>	generic, huawei, zte, ericsson or alcatel\n"
+		"	-d <ms>			Delay before each response (default 20)\n"
+		"	-r <ms>			Time until registered to the network (default 0)\n"
+		"	-u <ms>			Interval for unsolicited reports (default off)\n"
+		"	-c <count>		Answer NO CARRIER to the first <count> dial attempts\n"
+		"	-P <pin>		SIM requires the given PIN\n"
+		"	-b <ms>			Time the SIM is busy after entering the PIN (alcatel only,\n"
+		"				default 3000)\n"
+		"	-e <cmd>[=<cme>][:<n>]	Fail commands starting with <cmd>, with a +CME ERROR\n"
+		"				(or ERROR without <cme>), the first <n> times or always\n"
+		"	-n			Reject multiple commands on a single line\n"
+		"	-l <prefix>		Create symlinks <prefix>0 (data) and <prefix>1 (control)\n"
+		"	-v			Log all commands and responses to stderr\n", app);
+}
+
+int main(int argc, char *const argv[]) {
+	const char *link_prefix = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "m:d:r:u:c:P:b:e:nl:v")) != -1) {
+		switch (opt) {
+			case 'm': {
+				size_t i;
+				for (i = 0; i < lengthof(personalities); ++i)
+					if (!strcmp(optarg, personalities[i].name))
+						break;
+				if (i == lengthof(personalities)) {
+					fprintf(stderr, "Unknown personality: %s\n", optarg);
+					return UDIALD_EINVAL;
+				}
+				cfg.personality = i;
+				break;
+			}
+			case 'd':
+				cfg.delay = atoi(optarg);
+				break;
+			case 'r':
+				cfg.register_delay = atoi(optarg);
+				break;
+			case 'u':
+				cfg.urc_interval = atoi(optarg);
+				break;
+			case 'c':
+				cfg.nocarrier = atoi(optarg);
+				break;
+			case 'P':
+				cfg.pin = optarg;
+				break;
+			case 'b':
+				cfg.busy_after_pin = atoi(optarg);
+				break;
+			case 'e': {
+				if (cfg.nerrors == lengthof(cfg.errors)) {
+					fprintf(stderr, "Too many injected errors\n");
+					return UDIALD_EINVAL;
+				}
+				struct sim_error *e = &cfg.errors[cfg.nerrors++];
+				char *count = strchr(optarg, ':');
+				char *cme = strchr(optarg, '=');
+				e->count = count ? atoi(count + 1) : 0;
+				e->cme = cme ? atoi(cme + 1) : -1;
+				if (count)
+					*count = '\0';
+				if (cme)
+					*cme = '\0';
+				e->prefix = optarg;
+				break;
+			}
+			case 'n':
+				cfg.nobatch = true;
+				break;
+			case 'l':
+				link_prefix = optarg;
+				break;
+			case 'v':
+				verbose++;
+				break;
+			default:
+				usage(argv[0]);
+				return UDIALD_EINVAL;
+		}
+	}
+
+	// Data tty first, matching the most common profiles (datidx 0,
+	// ctlidx 1)
+	struct sim_tty *order[] = {&ttys[1], &ttys[0]};
+	for (size_t i = 0; i < lengthof(order); ++i) {
+		struct sim_tty *t = order[i];
+		char name[64];
+		int slave;
+		struct termios tio;
+		if (openpty(&t->master, &slave, name, NULL, NULL) < 0) {
+			perror("openpty");
+			return UDIALD_EINTERNAL;
+		}
+		// No line discipline processing, like a USB serial port.
+		// The slave is kept open, so the master does not see a
+		// hangup whenever udiald closes the tty.
+		tcgetattr(slave, &tio);
+		cfmakeraw(&tio);
+		tcsetattr(slave, TCSANOW, &tio);
+		printf("%s tty: %s\n", t->name, name);
+
+		if (link_prefix) {
+			char path[256];
+			snprintf(path, sizeof(path), "%s%zu", link_prefix, i);
+			unlink(path);
+			if (symlink(name, path) < 0) {
+				perror(path);
+				return UDIALD_EINTERNAL;
+			}
+		}
+	}
+	fflush(stdout);
+
+	signal(SIGINT, sim_signal);
+	signal(SIGTERM, sim_signal);
+
+	sim.start = udiald_util_now_ms();
+	sim.next_urc = sim.start + cfg.urc_interval;
+	while (!done) {
+		struct pollfd pfd[lengthof(ttys)];
+		for (size_t i = 0; i < lengthof(ttys); ++i)
+			pfd[i] = (struct pollfd){.fd = ttys[i].master, .events = POLLIN};
+
+		int timeout = sim_flush();
+		if (poll(pfd, lengthof(pfd), timeout) < 0)
+			continue;
+
+		for (size_t i = 0; i < lengthof(ttys); ++i)
+			if (pfd[i].revents & POLLIN)
+				sim_read(&ttys[i]);
+	}
+
+	if (link_prefix) {
+		char path[256];
+		for (size_t i = 0; i < lengthof(order); ++i) {
+			snprintf(path, sizeof(path), "%s%zu", link_prefix, i);
+			unlink(path);
+		}
+	}
+	return UDIALD_OK;
+}
@@ -0,0 +1,198 @@
+/**
+ *   udiald - UMTS connection manager
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307, USA.
+ *
+ */
+
+/*
+ * Replay a transcript recorded with udiald --transcript.
+ *
+ * The received data is fed through the regular response parser (in the
+ * same chunks as it was originally read), at the original speed or
+ * faster. For every command, the recorded response time is printed,
+ * along with the time spent parsing the response.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <syslog.h>
+#include <time.h>
+#include "udiald.h"
+
+int verbose = 0;
+
+static const char *channel_names[] = {
+	[UDIALD_TRANSCRIPT_CONTROL] = "ctl",
+	[UDIALD_TRANSCRIPT_DIAL] = "dial",
+};
+
+struct replay_channel {
+	int rd, wr;		/* Pipe to feed the parser */
+	bool active;		/* A command is waiting for its response */
+	uint64_t sent;		/* Recorded time the command was sent */
+	char command[64];
+	struct udiald_tty_read r;
+	uint64_t parse_ns;	/* Time spent parsing the current response */
+};
+
+static struct {
+	unsigned commands;
+	uint64_t latency_ms;
+	uint64_t max_latency_ms;
+	uint64_t parse_ns;
+} totals;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_ms(uint64_t ms) {
+	const struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000};
+	nanosleep(&ts, NULL);
+}
+
+static void usage(const char *app) {
+	fprintf(stderr,
+		"Usage: %s [-s <speed>] [-v] <transcript>\n\n"
+		"	-s <speed>	Replay speed factor (default 1, 0 = as fast as possible)\n"
+		"	-v		Show all lines parsed\n", app);
+}
+
+// Feed data received on a channel to the parser and report any
+// response completed by it.
+static void replay_rx(struct replay_channel *c, const char *name, uint64_t offset, const struct udiald_transcript_record *rec) {
+	if (write(c->wr, rec->data, rec->len) != rec->len) {
+		perror("write");
+		exit(1);
+	}
+
+	uint64_t start = now_ns();
+	udiald_tty_fill(c->rd);
+	if (!c->active) {
+		udiald_tty_drain(c->rd);
+		c->parse_ns += now_ns() - start;
+		return;
+	}
+	enum udiald_atres res = udiald_tty_parse(c->rd, &c->r, NULL);
+	c->parse_ns += now_ns() - start;
+	if (res == UDIALD_FAIL)
+		return;
+
+	uint64_t latency = rec->timestamp - c->sent;
+	printf("%8llu %-4s < %s (%zu lines, %llu ms, parsed in %llu ns)\n",
+		(unsigned long long)offset, name,
+		c->r.raw_lines[c->r.lines - 1], c->r.lines,
+		(unsigned long long)latency, (unsigned long long)c->parse_ns);
+
+	totals.commands++;
+	totals.latency_ms += latency;
+	if (latency > totals.max_latency_ms)
+		totals.max_latency_ms = latency;
+	totals.parse_ns += c->parse_ns;
+	c->active = false;
+
+	// Anything after the final result code is unsolicited
+	udiald_tty_drain(c->rd);
+}
+
+int main(int argc, char *const argv[]) {
+	double speed = 1;
+	int opt;
+	while ((opt = getopt(argc, argv, "s:v")) != -1) {
+		switch (opt) {
+			case 's':
+				speed = atof(optarg);
+				break;
+			case 'v':
+				verbose++;
+				break;
+			default:
+				usage(argv[0]);
+				return UDIALD_EINVAL;
+		}
+	}
+	if (optind + 1 != argc) {
+		usage(argv[0]);
+		return UDIALD_EINVAL;
+	}
+
+	openlog("udiald-replay", LOG_PERROR, LOG_USER);
+	udiald_log_setmask(LOG_UPTO(verbose ? LOG_DEBUG : LOG_WARNING));
+
+	int fd = open(argv[optind], O_RDONLY);
+	if (fd < 0 || udiald_transcript_read_header(fd) != UDIALD_OK) {
+		fprintf(stderr, "%s: Not a udiald transcript\n", argv[optind]);
+		return UDIALD_EINVAL;
+	}
+
+	struct replay_channel channels[lengthof(channel_names)];
+	for (size_t i = 0; i < lengthof(channels); ++i) {
+		int p[2];
+		if (pipe(p) < 0) {
+			perror("pipe");
+			return UDIALD_EINTERNAL;
+		}
+		fcntl(p[0], F_SETFL, O_NONBLOCK);
+		channels[i] = (struct replay_channel) {.rd = p[0], .wr = p[1]};
+	}
+
+	static struct udiald_transcript_record rec;
+	uint64_t first = 0, start = now_ns();
+	int ret;
+	while ((ret = udiald_transcript_read(fd, &rec)) > 0) {
+		if (rec.channel >= lengthof(channels))
+			continue;
+		if (!first)
+			first = rec.timestamp;
+
+		uint64_t offset = rec.timestamp - first;
+		if (speed > 0) {
+			uint64_t elapsed = (now_ns() - start) / 1000000;
+			uint64_t due = offset / speed;
+			if (due > elapsed)
+				sleep_ms(due - elapsed);
+		}
+
+		struct replay_channel *c = &channels[rec.channel];
+		const char *name = channel_names[rec.channel];
+		if (rec.dir == UDIALD_TRANSCRIPT_TX) {
+			size_t len = strcspn(rec.data, "\r");
+			if (len > rec.len)
+				len = rec.len;
+			snprintf(c->command, sizeof(c->command), "%.*s", (int)len, rec.data);
+			printf("%8llu %-4s > %s\n", (unsigned long long)offset, name, c->command);
+			udiald_tty_read_init(&c->r);
+			c->active = true;
+			c->sent = rec.timestamp;
+			c->parse_ns = 0;
+		} else {
+			replay_rx(c, name, offset, &rec);
+		}
+	}
+	if (ret < 0)
+		fprintf(stderr, "%s: Transcript is truncated\n", argv[optind]);
+
+	printf("%u responses, %llu ms total, %llu ms max, %llu ns parsing\n",
+		totals.commands, (unsigned long long)totals.latency_ms,
+		(unsigned long long)totals.max_latency_ms,
+		(unsigned long long)totals.parse_ns);
+	return UDIALD_OK;
+}